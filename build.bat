@@ -11,7 +11,7 @@ pushd %buildDir%
 set objDir=%buildDir%\obj\
 set outputExe=%buildDir%\tetris
 set libs=SDL2.lib SDL2main.lib SDL2_image.lib shell32.lib
-set source=%srcDir%\main.c %srcDir%\tetris.c
+set source=%srcDir%\main.c %srcDir%\tetris.c %srcDir%\clock.c %srcDir%\text.c %srcDir%\prof.c %srcDir%\log.c %srcDir%\tetris_core.c %srcDir%\pieces.c %srcDir%\eval.c %srcDir%\ai.c %srcDir%\replay.c %srcDir%\arena.c
 set INCLUDE=%srcDir%;%INCLUDE%
 
 
@@ -0,0 +1,324 @@
+#include "ai.h"
+#include <stdlib.h>
+
+static int compareRanks(const void* a, const void* b)
+{
+    float x = ((const tRank*)a)->score, y = ((const tRank*)b)->score;
+    return (x < y) - (x > y);
+}
+
+bool initAI(tAI* AI, const tGlassSize* G, int depth, int beam, int tt_bits)
+{
+    memset(AI, 0, sizeof(*AI));
+    if (depth < 1 || depth > AI_MAXDEPTH || beam < 1 || beam > AI_MAXBEAM || tt_bits < 1 || tt_bits > 28)
+    {
+        return false;
+    }
+    AI->depth = depth;
+    AI->beam = beam;
+    AI->size = *G;
+    AI->W = DEFAULT_WEIGHTS;
+    AI->item = -1;
+
+    tRng R;
+    seedRandom(&R, 0x7e7715);
+    for (int i = 0; i < G->h; i++)
+    {
+        for (int j = 0; j < G->w; j++)
+        {
+            AI->zobrist[i][j] = (uint64_t)getRandom(&R) << 32 | getRandom(&R);
+        }
+    }
+
+    // room for twice the placements of the empty glass for every kept board
+    AI->max_nodes = beam * ROTATIONS * G->w * 2;
+    AI->tt_mask = (1u << tt_bits) - 1;
+    AI->tt = calloc((size_t)AI->tt_mask + 1, sizeof(tTTEntry));
+
+    // the largest search: the kept boards and a full depth of candidates, every buffer rounded to the alignment
+    size_t n = (size_t)AI->max_nodes;
+    size_t size = sizeof(tAINode) * (beam + n) + sizeof(tRow) * G->h * n + sizeof(tFeatures) * n + sizeof(int) * n +
+                  sizeof(tRank) * n + 6 * ARENA_ALIGN;
+    if (!initArena(&AI->arena, size) || !AI->tt)
+    {
+        freeAI(AI);
+        return false;
+    }
+    return true;
+}
+
+void freeAI(tAI* AI)
+{
+    free(AI->tt);
+    freeArena(&AI->arena);
+    AI->tt = NULL;
+    AI->beam_nodes = AI->nodes = NULL;
+    AI->boards = NULL;
+    AI->features = NULL;
+    AI->pending = NULL;
+    AI->ranks = NULL;
+}
+
+uint64_t hashBoard(const tAI* AI, const tRow* rows)
+{
+    uint64_t h = 0;
+    for (int i = AI->size.h - 1; i >= 0 && rows[i] != 0; i--)
+    {
+        for (uint64_t bits = rows[i]; bits != 0; bits &= bits - 1)
+        {
+            h ^= AI->zobrist[i][lowestBit(bits)];
+        }
+    }
+    return h;
+}
+
+/**
+ * @brief Zobrist keys of the item blocks (the board hash changes by XOR with it)
+ *
+ * @param AI : Bot data
+ * @param id : Item
+ * @param pl : Item placement
+ * @return uint64_t : XOR of the keys of the item cells
+ */
+static uint64_t hashPlacement(const tAI* AI, int id, const tPlacement* pl)
+{
+    const tPiece* P = &PIECES[id][pl->rot];
+    uint64_t h = 0;
+    for (int i = P->top; i <= P->bottom; i++)
+    {
+        for (uint64_t bits = (uint64_t)P->rows[i] << (pl->gx + P->left); bits != 0; bits &= bits - 1)
+        {
+            h ^= AI->zobrist[pl->gy + i][lowestBit(bits)];
+        }
+    }
+    return h;
+}
+
+/**
+ * @brief Put all placements of the item on the board into the candidates of the next depth
+ *
+ * @param AI : Bot data
+ * @param parent : Board of the current depth
+ * @param id : Item
+ * @param gx, gy, rot : Start position of the item
+ * @param tag : Search and depth of the candidates
+ * @param n : Number of the candidates, updated
+ * @param n_pending : Number of the candidates without score, updated
+ */
+static void expandNode(tAI* AI, const tAINode* parent, int id, int gx, int gy, int rot, uint32_t tag, int* n,
+                       int* n_pending)
+{
+    tPlacement pl[MAXPLACEMENTS];
+    int np = findPlacements(&AI->size, parent->rows, id, gx, gy, rot, pl, MAXPLACEMENTS);
+    bool root = tag % AI_MAXDEPTH == 0;
+
+    for (int p = 0; p < np; p++)
+    {
+        uint64_t h = parent->hash ^ hashPlacement(AI, id, &pl[p]);
+        tTTEntry* E = &AI->tt[h & AI->tt_mask];
+        AI->searched++;
+        if (E->key == h && E->tag == tag)
+        {
+            // the same board is reached by another move order: keep the better history
+            tAINode* N = &AI->nodes[E->node];
+            if (parent->bonus > N->bonus)
+            {
+                N->bonus = parent->bonus;
+                N->first = root ? pl[p] : parent->first;
+            }
+            AI->merged++;
+            continue;
+        }
+        if (*n == AI->max_nodes)
+        {
+            continue;
+        }
+
+        tAINode* N = &AI->nodes[*n];
+        memcpy(N->rows, parent->rows, sizeof(tRow) * AI->size.h);
+        placeItem(N->rows, id, &pl[p]);
+        N->hash = h;
+        N->bonus = parent->bonus;
+        N->first = root ? pl[p] : parent->first;
+        if (E->key == h)
+        {
+            // the board was scored by the previous searches
+            N->score = E->eval;
+            AI->cached++;
+        }
+        else
+        {
+            E->key = h;
+            AI->pending[(*n_pending)++] = *n;
+        }
+        E->tag = tag;
+        E->node = *n;
+        (*n)++;
+    }
+}
+
+bool searchPlacement(tAI* AI, tState* ST, tPlacement* best)
+{
+    int ids[AI_MAXDEPTH];
+    if (ST->size.w != AI->size.w || ST->size.h != AI->size.h)
+    {
+        return false;
+    }
+    ids[0] = ST->ITEM_ID;
+    peekItems(ST, ids + 1, AI->depth - 1);
+    AI->search++;
+
+    // a new item: nothing of the previous search is needed
+    resetArena(&AI->arena);
+    AI->beam_nodes = allocArena(&AI->arena, sizeof(tAINode) * AI->beam);
+    size_t mark = AI->arena.used;
+
+    tAINode* root = &AI->beam_nodes[0];
+    memcpy(root->rows, ST->rows, sizeof(tRow) * AI->size.h);
+    root->hash = hashBoard(AI, root->rows);
+    root->bonus = 0;
+    int n_beam = 1;
+    bool found = false;
+
+    for (int d = 0; d < AI->depth; d++)
+    {
+        uint32_t tag = AI->search * AI_MAXDEPTH + d;
+        int n = 0, n_pending = 0;
+        releaseArena(&AI->arena, mark);
+        AI->nodes = allocArena(&AI->arena, sizeof(tAINode) * AI->max_nodes);
+        AI->pending = allocArena(&AI->arena, sizeof(int) * AI->max_nodes);
+        for (int k = 0; k < n_beam; k++)
+        {
+            if (d == 0)
+            {
+                expandNode(AI, &AI->beam_nodes[k], ids[d], ST->gx, ST->gy, ST->ROTATION, tag, &n, &n_pending);
+            }
+            else
+            {
+                expandNode(AI, &AI->beam_nodes[k], ids[d], (AI->size.w - ITEMBLOCKS) / 2, 0, 0, tag, &n, &n_pending);
+            }
+        }
+        if (n == 0)
+        {
+            // the game is over at this depth on every board, keep the best move of the previous depth
+            break;
+        }
+
+        // score the new boards in one batch, the batch buffers have the exact size
+        AI->boards = allocArena(&AI->arena, sizeof(tRow) * AI->size.h * n_pending);
+        AI->features = allocArena(&AI->arena, sizeof(tFeatures) * n_pending);
+        for (int i = 0; i < n_pending; i++)
+        {
+            memcpy(AI->boards + (size_t)i * AI->size.h, AI->nodes[AI->pending[i]].rows, sizeof(tRow) * AI->size.h);
+        }
+        evalBoards(&AI->size, AI->boards, n_pending, AI->features);
+        for (int i = 0; i < n_pending; i++)
+        {
+            tAINode* N = &AI->nodes[AI->pending[i]];
+            N->score = scoreFeatures(&AI->features[i], &AI->W);
+            tTTEntry* E = &AI->tt[N->hash & AI->tt_mask];
+            if (E->key == N->hash)
+            {
+                E->eval = N->score;
+            }
+        }
+
+        // keep the best boards, the full lines are removed before the next item
+        tRank* ranks = AI->ranks = allocArena(&AI->arena, sizeof(tRank) * n);
+        if (AI->arena.used > AI->arena_peak)
+        {
+            AI->arena_peak = AI->arena.used;
+        }
+        for (int i = 0; i < n; i++)
+        {
+            ranks[i].score = AI->nodes[i].score + AI->nodes[i].bonus;
+            ranks[i].node = i;
+        }
+        qsort(ranks, n, sizeof(tRank), compareRanks);
+        *best = AI->nodes[ranks[0].node].first;
+        found = true;
+
+        n_beam = n < AI->beam ? n : AI->beam;
+        for (int k = 0; k < n_beam && d + 1 < AI->depth; k++)
+        {
+            tAINode* B = &AI->beam_nodes[k];
+            const tAINode* N = &AI->nodes[ranks[k].node];
+            memcpy(B->rows, N->rows, sizeof(tRow) * AI->size.h);
+            B->hash = N->hash;
+            B->bonus = N->bonus;
+            B->first = N->first;
+            int lines = removeFullRows(&AI->size, B->rows);
+            if (lines > 0)
+            {
+                B->bonus += AI->W.lines * lines;
+                B->hash = hashBoard(AI, B->rows);
+            }
+        }
+    }
+    return found;
+}
+
+tAction policyAI(tState* ST, void* ctx)
+{
+    tAI* AI = ctx;
+
+    if (AI->path_pos < AI->path_len && AI->path[AI->path_pos] == ACTION_NONE && ST->gx == AI->gx &&
+        ST->gy == AI->gy + 1 && ST->ROTATION == AI->rot)
+    {
+        // the item fell by one line as planned
+        AI->gy++;
+        AI->path_pos++;
+    }
+    bool new_item = AI->item != ST->items;
+    if (new_item || ST->gx != AI->gx || ST->gy != AI->gy || ST->ROTATION != AI->rot)
+    {
+        // new item, or the item is not where the plan expects it: find the path again
+        AI->item = ST->items;
+        AI->path_len = new_item ? -1
+                                : findPlacementPath(&ST->size, ST->rows, ST->ITEM_ID, ST->gx, ST->gy, ST->ROTATION,
+                                                    &AI->target, AI->path, AI_MAXPATH);
+        if (AI->path_len < 0 && searchPlacement(AI, ST, &AI->target))
+        {
+            AI->path_len = findPlacementPath(&ST->size, ST->rows, ST->ITEM_ID, ST->gx, ST->gy, ST->ROTATION,
+                                             &AI->target, AI->path, AI_MAXPATH);
+        }
+        if (AI->path_len < 0)
+        {
+            AI->path_len = 0;
+        }
+        AI->path_pos = 0;
+        AI->gx = ST->gx;
+        AI->gy = ST->gy;
+        AI->rot = ST->ROTATION;
+    }
+
+    // the rest of the path is falling down: drop the item
+    int pos = AI->path_pos;
+    while (pos < AI->path_len && AI->path[pos] == ACTION_NONE)
+    {
+        pos++;
+    }
+    if (pos == AI->path_len)
+    {
+        return ACTION_DROP;
+    }
+
+    tAction action = AI->path[AI->path_pos];
+    switch (action)
+    {
+    case ACTION_LEFT:
+        AI->gx--;
+        break;
+    case ACTION_RIGHT:
+        AI->gx++;
+        break;
+    case ACTION_ROTATE:
+        AI->rot = (int8_t)((AI->rot + 1) % ROTATIONS);
+        break;
+    default:
+        // wait for the fall by one line
+        return ACTION_NONE;
+    }
+    AI->path_pos++;
+    return action;
+}
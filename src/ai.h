@@ -0,0 +1,132 @@
+#ifndef AI_H
+#define AI_H
+
+// Beam search bot: looks several items ahead (the current item and the next ones from the preview)
+
+#include "arena.h"
+#include "eval.h"
+#include <limits.h>
+
+#define AI_MAXDEPTH 8 // Maximum number of searched items
+#define AI_MAXPATH (2 * (GLASS_MAX_W + GLASS_MAX_H)) // Maximum number of actions to reach the chosen placement
+#define AI_MAXBEAM (INT_MAX / (ROTATIONS * GLASS_MAX_W * 2)) // Maximum number of kept boards (the nodes fit in an int)
+
+/**
+ * @brief Transposition table entry: a board seen by the search
+ *
+ */
+typedef struct _tttentry
+{
+    uint64_t key; // Zobrist hash of the board (0 - empty entry)
+    float eval;   // Score of the board features
+    uint32_t tag; // Search and depth of the last candidate with this board
+    int32_t node; // Index of that candidate
+} tTTEntry;
+
+/**
+ * @brief Candidate board of the search
+ *
+ */
+typedef struct _tainode
+{
+    tRow rows[GLASS_MAX_H]; // Board with the placed item (full lines are not removed yet), tAI.size.h lines used
+    uint64_t hash;          // Zobrist hash of the board
+    float bonus;            // Score of the lines removed before this board
+    float score;            // Score of the board features
+    tPlacement first;       // Placement of the current item that leads to this board
+} tAINode;
+
+/**
+ * @brief Sort key of a candidate
+ *
+ */
+typedef struct _trank
+{
+    float score; // Score with the bonus
+    int node;    // Candidate index
+} tRank;
+
+/**
+ * @brief Bot data: search parameters, buffers and the plan for the current item
+ *
+ */
+typedef struct _tai
+{
+    int depth;                                  // Number of searched items (current + preview)
+    int beam;                                   // Number of boards kept at each depth
+    tGlassSize size;                            // Glass size of the games
+    tWeights W;                                 // Weights of the board score
+    uint64_t zobrist[GLASS_MAX_H][GLASS_MAX_W]; // Random keys of the glass cells
+    tTTEntry *tt;                               // Transposition table
+    uint32_t tt_mask;                           // Table size - 1
+    uint32_t search;                            // Number of searches (tags the entries of the current one)
+    int max_nodes;                              // Maximum number of candidates at one depth
+    tArena arena;                               // Search buffers, reset at each item (one arena per bot and thread)
+    tAINode *beam_nodes;                        // Boards kept at the current depth, beam size
+    tAINode *nodes;                             // Candidates of the next depth, max_nodes size
+    tRow *boards;                               // Batch of the boards for evaluation, size.h rows per board
+    tFeatures *features;                        // Features of the batch
+    int *pending;                               // Candidates in the batch, max_nodes size
+    tRank *ranks;                               // Candidates sorted by score
+    size_t arena_peak;                          // Statistics: most arena bytes used by one search
+    int item;                                   // Item number (tState.items) the plan is made for
+    tPlacement target;                          // Chosen placement of the current item
+    tAction path[AI_MAXPATH];                   // Actions to reach the target
+    int path_len, path_pos;                     // Path length and the next action
+    int8_t gx, gy, rot;                         // Expected item position
+    long searched, merged, cached;              // Statistics: candidate boards, merged duplicates, scores from the table
+} tAI;
+
+/**
+ * @brief Allocate the bot buffers: the transposition table and the arena for the worst case of one search
+ *
+ * @param AI : Bot data
+ * @param G : Glass size of the games
+ * @param depth : Number of searched items (1..AI_MAXDEPTH)
+ * @param beam : Number of boards kept at each depth (1..AI_MAXBEAM)
+ * @param tt_bits : Transposition table size is 2^tt_bits entries
+ * @return true : Success
+ * @return false : Wrong parameters or out of memory
+ */
+bool initAI(tAI *AI, const tGlassSize *G, int depth, int beam, int tt_bits);
+
+/**
+ * @brief Release the bot buffers
+ *
+ * @param AI : Bot data
+ */
+void freeAI(tAI *AI);
+
+/**
+ * @brief Zobrist hash of the board
+ *
+ * @param AI : Bot data
+ * @param rows : Occupancy bitboard of the glass
+ * @return uint64_t : XOR of the keys of the filled cells
+ */
+uint64_t hashBoard(const tAI *AI, const tRow *rows);
+
+/**
+ * @brief Beam search of the best placement of the current item
+ *
+ * The search buffers are taken from the bot arena, it is reset at the start (each spawned item)
+ * and the candidates of a depth are released after it, so the search never calls malloc().
+ *
+ * @param AI : Bot data
+ * @param ST : State data structure (the item is falling)
+ * @param best : Chosen placement
+ * @return true : Placement is found
+ * @return false : The item can not be placed (or the glass size is not the one of the bot)
+ */
+bool searchPlacement(tAI *AI, tState *ST, tPlacement *best);
+
+/**
+ * @brief Bot policy: moves the item along the path to the placement chosen by the beam search
+ *
+ * @param ST : State data structure
+ * @param ctx : Bot data (tAI)
+ * @return tAction : Chosen action
+ */
+tAction policyAI(tState *ST, void *ctx);
+
+#endif // AI_H
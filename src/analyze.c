@@ -0,0 +1,525 @@
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#define _POSIX_C_SOURCE 200809L
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "clock.h"
+#include "eval.h"
+#include "replay.h"
+#include <pthread.h>
+#include <stdlib.h>
+
+// Replay corpus analytics: maps replay files and packs (replays one after another) into memory
+// and plays them on all cores straight from the mapped pages
+
+#define MAXTHREADS 256
+#define BATCH_REPLAYS 64 // Replays of a pack taken by a worker at once
+#define HOLE_MINUTES 30  // Hole statistics by game minute (the last one collects the rest)
+#define MAXPATH 4096
+
+/**
+ * @brief Mapped file shared by the workers playing its replays
+ *
+ */
+typedef struct _tsource
+{
+    const uint8_t *data; // Mapped file (NULL for an empty file)
+    size_t size;         // File size
+    size_t pos;          // Replays before pos are given to the workers
+    int users;           // Workers playing the replays of the file
+    const char *path;    // File name
+} tSource;
+
+/**
+ * @brief Replays of one file given to a worker
+ *
+ */
+typedef struct _twork
+{
+    tSource *src;      // File
+    size_t start, end; // Byte range of the replays
+} tWork;
+
+/**
+ * @brief Aggregate statistics of the played replays
+ *
+ */
+typedef struct _tstats
+{
+    long games;                 // Valid replays
+    long invalid;               // Broken replays (the rest of the file is skipped)
+    long mismatch;              // Replays with a different final glass
+    long items, lines, actions; // Totals of all games
+    long max_lines;             // Best game
+    uint64_t game_ms;           // Total game time
+    uint64_t bytes;             // Total size of the replays
+    long topout[MAXITEMS];      // Games over by the item which did not fit
+    long left;                  // Games left by the player
+    long holes[HOLE_MINUTES];   // Sum of holes after the stopped items, by game minute
+    long samples[HOLE_MINUTES]; // Number of stopped items, by game minute
+} tStats;
+
+/**
+ * @brief Worker data
+ *
+ */
+typedef struct _tworker
+{
+    pthread_t thread; // Worker thread
+    tStats stats;     // Own statistics, summed at the end
+} tWorker;
+
+static struct
+{
+    pthread_mutex_t lock; // Protects the fields below and the sources
+    char **paths;         // Replay files
+    int n_paths;          // Number of files
+    int next_path;        // Next file to map
+    tSource *current;     // File being split into batches
+    long files;           // Mapped files
+    long failed;          // Files which can not be mapped
+} POOL;
+
+static tWorker WORKERS[MAXTHREADS];
+
+/**
+ * @brief Map the file for reading
+ *
+ * @param path : File name
+ * @param data : Mapped file (NULL for an empty file)
+ * @param size : File size
+ * @return true : Success
+ * @return false : The file can not be opened or mapped
+ */
+static bool mapFile(const char *path, const uint8_t **data, size_t *size)
+{
+    bool ok = false;
+    *data = NULL;
+    *size = 0;
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN,
+                              NULL);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+    LARGE_INTEGER len;
+    if (GetFileSizeEx(file, &len))
+    {
+        HANDLE mapping = len.QuadPart > 0 ? CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL) : NULL;
+        if (mapping)
+        {
+            *data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            CloseHandle(mapping);
+        }
+        ok = len.QuadPart == 0 || *data != NULL;
+        *size = *data ? (size_t)len.QuadPart : 0;
+    }
+    CloseHandle(file);
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == 0)
+    {
+        void *p = st.st_size > 0 ? mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+        if (p != MAP_FAILED)
+        {
+            // the replays are read front to back: let the kernel read ahead
+            posix_madvise(p, (size_t)st.st_size, POSIX_MADV_SEQUENTIAL);
+            *data = p;
+            *size = (size_t)st.st_size;
+        }
+        ok = st.st_size == 0 || *data != NULL;
+    }
+    close(fd);
+#endif
+    return ok;
+}
+
+static void unmapFile(const uint8_t *data, size_t size)
+{
+    if (!data)
+    {
+        return;
+    }
+#if defined(_WIN32)
+    (void)size;
+    UnmapViewOfFile(data);
+#else
+    munmap((void *)data, size);
+#endif
+}
+
+/**
+ * @brief Add the file to the list, the replay files of the directory recursively
+ *
+ * @param path : File or directory name
+ * @param cap : Allocated size of POOL.paths
+ * @return true : Success
+ * @return false : Out of memory
+ */
+static bool addPath(const char *path, int *cap)
+{
+    char sub[MAXPATH];
+    bool ok = true;
+#if defined(_WIN32)
+    DWORD attr = GetFileAttributesA(path);
+    if (attr != INVALID_FILE_ATTRIBUTES && (attr & FILE_ATTRIBUTE_DIRECTORY))
+    {
+        WIN32_FIND_DATAA fd;
+        snprintf(sub, sizeof(sub), "%s\\*", path);
+        HANDLE h = FindFirstFileA(sub, &fd);
+        if (h == INVALID_HANDLE_VALUE)
+        {
+            return true;
+        }
+        do
+        {
+            if (fd.cFileName[0] != '.')
+            {
+                snprintf(sub, sizeof(sub), "%s\\%s", path, fd.cFileName);
+                ok = addPath(sub, cap);
+            }
+        } while (ok && FindNextFileA(h, &fd));
+        FindClose(h);
+        return ok;
+    }
+#else
+    DIR *dir = opendir(path);
+    if (dir)
+    {
+        struct dirent *e;
+        while (ok && (e = readdir(dir)) != NULL)
+        {
+            if (e->d_name[0] != '.')
+            {
+                snprintf(sub, sizeof(sub), "%s/%s", path, e->d_name);
+                ok = addPath(sub, cap);
+            }
+        }
+        closedir(dir);
+        return ok;
+    }
+#endif
+    if (POOL.n_paths == *cap)
+    {
+        *cap = *cap ? *cap * 2 : 1024;
+        char **paths = realloc(POOL.paths, sizeof(char *) * (size_t)*cap);
+        if (!paths)
+        {
+            return false;
+        }
+        POOL.paths = paths;
+    }
+    size_t len = strlen(path) + 1;
+    POOL.paths[POOL.n_paths] = malloc(len);
+    if (!POOL.paths[POOL.n_paths])
+    {
+        return false;
+    }
+    memcpy(POOL.paths[POOL.n_paths++], path, len);
+    return true;
+}
+
+/**
+ * @brief Take the next batch of replays, map the next file when the current one is split
+ *
+ * @param W : Work to do
+ * @param S : Statistics of the worker (broken files are counted here)
+ * @return true : The batch is taken
+ * @return false : All files are given out
+ */
+static bool takeWork(tWork *W, tStats *S)
+{
+    bool taken = false;
+    pthread_mutex_lock(&POOL.lock);
+    while (!taken)
+    {
+        tSource *src = POOL.current;
+        if (src && src->pos < src->size)
+        {
+            // the replays know their sizes: a short scan of the records finds the batch end
+            W->src = src;
+            W->start = src->pos;
+            W->end = src->pos;
+            for (int i = 0; i < BATCH_REPLAYS && src->pos < src->size; i++)
+            {
+                size_t n = getReplaySize(src->data + src->pos, src->size - src->pos);
+                if (n == 0)
+                {
+                    fprintf(stderr, "%s: broken replay at byte %zu, the rest is skipped\n", src->path, src->pos);
+                    S->invalid++;
+                    src->pos = src->size;
+                    break;
+                }
+                src->pos += n;
+                W->end = src->pos;
+            }
+            src->users++;
+            taken = true;
+        }
+        else if (POOL.next_path < POOL.n_paths)
+        {
+            // the file is given out: the last user releases it
+            if (src && src->users == 0)
+            {
+                unmapFile(src->data, src->size);
+                free(src);
+            }
+            POOL.current = NULL;
+            src = calloc(1, sizeof(tSource));
+            if (!src)
+            {
+                break;
+            }
+            src->path = POOL.paths[POOL.next_path++];
+            if (mapFile(src->path, &src->data, &src->size))
+            {
+                POOL.files++;
+            }
+            else
+            {
+                fprintf(stderr, "%s: can not be mapped\n", src->path);
+                POOL.failed++;
+            }
+            POOL.current = src;
+        }
+        else
+        {
+            break;
+        }
+    }
+    pthread_mutex_unlock(&POOL.lock);
+    return taken;
+}
+
+/**
+ * @brief Return the batch, release the file if it is given out and played
+ *
+ * @param W : Played work
+ */
+static void finishWork(tWork *W)
+{
+    pthread_mutex_lock(&POOL.lock);
+    tSource *src = W->src;
+    if (--src->users == 0 && src->pos == src->size && src != POOL.current)
+    {
+        unmapFile(src->data, src->size);
+        free(src);
+    }
+    pthread_mutex_unlock(&POOL.lock);
+}
+
+/**
+ * @brief Playback observer: holes of the glass after every stopped item
+ *
+ * @param ST : State data structure
+ * @param ms : Game time
+ * @param ctx : Statistics (tStats)
+ */
+static void countHoles(const tState *ST, uint32_t ms, void *ctx)
+{
+    tStats *S = ctx;
+    tFeatures F;
+    uint32_t minute = ms / 60000;
+    int m = minute < HOLE_MINUTES ? (int)minute : HOLE_MINUTES - 1;
+    evalBoards(&ST->size, ST->rows, 1, &F);
+    S->holes[m] += F.holes;
+    S->samples[m]++;
+}
+
+static void *worker(void *arg)
+{
+    tWorker *W = arg;
+    tStats *S = &W->stats;
+    tState ST;
+    tWork work;
+
+    while (takeWork(&work, S))
+    {
+        const uint8_t *data = work.src->data;
+        for (size_t pos = work.start; pos < work.end;)
+        {
+            size_t n = getReplaySize(data + pos, work.end - pos);
+            if (n == 0)
+            {
+                break;
+            }
+            tReplayResult res = playReplay(data + pos, n, &ST, countHoles, S);
+            pos += n;
+            if (!res.valid)
+            {
+                S->invalid++;
+                continue;
+            }
+            S->games++;
+            S->mismatch += !res.verified;
+            S->items += ST.items;
+            S->lines += ST.lines;
+            S->actions += res.actions;
+            S->max_lines = ST.lines > S->max_lines ? ST.lines : S->max_lines;
+            S->game_ms += res.time;
+            S->bytes += n;
+            if (res.finished)
+            {
+                // the item which did not fit is the current one
+                S->topout[ST.ITEM_ID]++;
+            }
+            else
+            {
+                S->left++;
+            }
+        }
+        finishWork(&work);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Add the worker statistics to the total
+ *
+ * @param T : Total
+ * @param S : Worker statistics
+ */
+static void addStats(tStats *T, const tStats *S)
+{
+    T->games += S->games;
+    T->invalid += S->invalid;
+    T->mismatch += S->mismatch;
+    T->items += S->items;
+    T->lines += S->lines;
+    T->actions += S->actions;
+    T->max_lines = S->max_lines > T->max_lines ? S->max_lines : T->max_lines;
+    T->game_ms += S->game_ms;
+    T->bytes += S->bytes;
+    T->left += S->left;
+    for (int i = 0; i < MAXITEMS; i++)
+    {
+        T->topout[i] += S->topout[i];
+    }
+    for (int m = 0; m < HOLE_MINUTES; m++)
+    {
+        T->holes[m] += S->holes[m];
+        T->samples[m] += S->samples[m];
+    }
+}
+
+static void printStats(const tStats *T, double wall)
+{
+    static const char ITEM_NAMES[MAXITEMS] = {'I', 'O', 'L', 'J', 'S', 'Z', 'T'};
+    double minutes = T->game_ms / 60000.0;
+    double games = T->games > 0 ? (double)T->games : 1.0;
+
+    printf("%ld files, %.1f MB, %ld games (%ld invalid, %ld mismatch) in %.3f s\n", POOL.files, T->bytes / 1e6,
+           T->games, T->invalid, T->mismatch, wall);
+    printf("%.1f MB/s, %.1f games/s\n", wall > 0 ? T->bytes / 1e6 / wall : 0.0, wall > 0 ? T->games / wall : 0.0);
+    printf("lines/game: %.2f (max %ld), items/game: %.1f, actions/game: %.1f\n", T->lines / games, T->max_lines,
+           T->items / games, T->actions / games);
+    printf("pieces/minute: %.1f, game time: %.1f min/game\n", minutes > 0 ? T->items / minutes : 0.0,
+           minutes / games);
+    printf("holes by game minute:");
+    for (int m = 0; m < HOLE_MINUTES; m++)
+    {
+        if (T->samples[m] > 0)
+        {
+            printf(" %s%d:%.2f", m == HOLE_MINUTES - 1 ? ">=" : "", m, (double)T->holes[m] / T->samples[m]);
+        }
+    }
+    printf("\ngame over:");
+    for (int i = 0; i < MAXITEMS; i++)
+    {
+        printf(" %c:%ld", ITEM_NAMES[i], T->topout[i]);
+    }
+    printf(", left by the player: %ld\n", T->left);
+}
+
+static int countCores(void)
+{
+#if defined(_WIN32)
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    return (int)si.dwNumberOfProcessors;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+#endif
+}
+
+static void usage(const char *prog)
+{
+    printf("Usage: %s [-threads T] FILE|DIR...\n", prog);
+}
+
+/**
+ * @brief Replay corpus analytics
+ *
+ * @param argc : Number of arguments passed to the program
+ * @param argv : Values of arguments passed to the program (replay files, packs and directories of them)
+ * @return int
+ */
+int main(int argc, char **argv)
+{
+    int threads = countCores();
+    int cap = 0;
+    bool ok = true;
+
+    for (int i = 1; i < argc && ok; i++)
+    {
+        if (strcmp(argv[i], "-threads") == 0 && i + 1 < argc)
+        {
+            threads = atoi(argv[++i]);
+        }
+        else
+        {
+            ok = addPath(argv[i], &cap);
+        }
+    }
+    threads = threads > MAXTHREADS ? MAXTHREADS : threads;
+    if (!ok || POOL.n_paths == 0 || threads < 1)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    pthread_mutex_init(&POOL.lock, NULL);
+    uint64_t start = clock_ns();
+    for (int t = 0; t < threads; t++)
+    {
+        pthread_create(&WORKERS[t].thread, NULL, worker, &WORKERS[t]);
+    }
+    tStats total = {0};
+    for (int t = 0; t < threads; t++)
+    {
+        pthread_join(WORKERS[t].thread, NULL);
+        addStats(&total, &WORKERS[t].stats);
+    }
+    double wall = (clock_ns() - start) / 1e9;
+    if (POOL.current)
+    {
+        unmapFile(POOL.current->data, POOL.current->size);
+        free(POOL.current);
+    }
+    pthread_mutex_destroy(&POOL.lock);
+
+    printStats(&total, wall);
+    if (POOL.failed > 0)
+    {
+        printf("%ld files can not be read\n", POOL.failed);
+    }
+    for (int i = 0; i < POOL.n_paths; i++)
+    {
+        free(POOL.paths[i]);
+    }
+    free(POOL.paths);
+    return total.invalid > 0 || total.mismatch > 0 || POOL.failed > 0;
+}
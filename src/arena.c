@@ -0,0 +1,20 @@
+#include "arena.h"
+#include <stdlib.h>
+
+bool initArena(tArena* A, size_t size)
+{
+    // the block size is a multiple of the alignment, so every allocation stays aligned (malloc() aligns the block)
+    size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+    A->base = malloc(size);
+    A->size = A->base ? size : 0;
+    A->used = 0;
+    return A->base != NULL;
+}
+
+void freeArena(tArena* A)
+{
+    free(A->base);
+    A->base = NULL;
+    A->size = 0;
+    A->used = 0;
+}
@@ -0,0 +1,81 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+// Arena allocator: one memory block taken from the front, everything is released at once
+// (or back to a mark taken before)
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define ARENA_ALIGN 8 // Alignment of the allocations (enough for uint64_t)
+
+/**
+ * @brief Arena data structure
+ *
+ */
+typedef struct _tarena
+{
+    uint8_t *base; // Memory block (aligned to ARENA_ALIGN)
+    size_t size;   // Block size in bytes
+    size_t used;   // Bytes taken from the front (the mark of the next allocation)
+} tArena;
+
+/**
+ * @brief Allocate the memory block of the arena
+ *
+ * @param A : Arena
+ * @param size : Block size in bytes
+ * @return true : The arena is ready
+ * @return false : Out of memory
+ */
+bool initArena(tArena *A, size_t size);
+
+/**
+ * @brief Release the memory block of the arena
+ *
+ * @param A : Arena
+ */
+void freeArena(tArena *A);
+
+/**
+ * @brief Take aligned memory from the arena
+ *
+ * @param A : Arena
+ * @param n : Number of bytes
+ * @return void* : Memory (not cleared), NULL if the arena is full
+ */
+static inline void *allocArena(tArena *A, size_t n)
+{
+    if (n > A->size - A->used)
+    {
+        return NULL;
+    }
+    // the block size is a multiple of the alignment: the rounded size fits too
+    void *p = A->base + A->used;
+    A->used += (n + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+    return p;
+}
+
+/**
+ * @brief Release everything allocated after the mark
+ *
+ * @param A : Arena
+ * @param mark : Value of A->used taken before the allocations
+ */
+static inline void releaseArena(tArena *A, size_t mark)
+{
+    A->used = mark;
+}
+
+/**
+ * @brief Release all allocations
+ *
+ * @param A : Arena
+ */
+static inline void resetArena(tArena *A)
+{
+    A->used = 0;
+}
+
+#endif // ARENA_H
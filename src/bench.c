@@ -0,0 +1,417 @@
+#include "clock.h"
+#include "eval.h"
+#include <stdlib.h>
+
+// Microbenchmarks of the engine primitives: ns per call on typical boards,
+// the median of timed rounds after warm-up rounds
+
+#define MAXROUNDS 1001
+#define WARMUP 3 // Rounds run before the timed ones
+
+/**
+ * @brief Item positions of the fixtures
+ *
+ */
+typedef enum
+{
+    AT_TOP,  // The item just appeared
+    STOPPED, // The item at its final placement (the most lines, then the lowest)
+    LOCKED   // The stopped item is copied to the glass, the full lines are not removed yet
+} tItemPosition;
+
+/**
+ * @brief What is put back before every call of an operation which changes the state
+ *
+ */
+typedef enum
+{
+    RESET_NONE,    // The state is not changed
+    RESET_ITEM,    // Only the item moves: gx, gy, ROTATION and GAME_STATE are put back
+    RESET_SNAPSHOT // The glass changes: the state is restored from the fixture snapshot
+} tReset;
+
+/**
+ * @brief Board fixture: the glass and the falling item in every position
+ *
+ */
+typedef struct _tfixture
+{
+    const char *name;                                 // Fixture name
+    tState states[3];                                 // Game states by tItemPosition
+    uint64_t snapshots[3][SNAPSHOT_MAX_SIZE / 8 + 1]; // Snapshots of the states (the changed state is restored)
+    int lines;                                        // Lines cleared by the stopped item
+} tFixture;
+
+/**
+ * @brief Benchmarked operation
+ *
+ */
+typedef struct _top
+{
+    const char *name;       // Operation name
+    int (*run)(tState *ST); // Call of the primitive
+    tItemPosition pos;      // State of the fixture
+    tReset reset;           // Reset of the state before every call (its time is measured alone and subtracted)
+} tOp;
+
+static tUndoStack UNDO;                              // Undo stack of the undo operation
+static uint64_t SNAPSHOT[SNAPSHOT_MAX_SIZE / 8 + 1]; // Snapshot of the save operation
+static uint64_t FORK[FORK_MAX_SIZE / 8 + 1];         // Fork of the fork operations
+
+static int opReset(tState *ST)
+{
+    return ST->gx;
+}
+
+static int opCheckLeft(tState *ST)
+{
+    return checkItemLeft(ST);
+}
+
+static int opCheckRight(tState *ST)
+{
+    return checkItemRight(ST);
+}
+
+static int opCheckBottom(tState *ST)
+{
+    return checkItemBottom(ST);
+}
+
+static int opRotate(tState *ST)
+{
+    return rotateItem(ST);
+}
+
+static int opCopyBlocks(tState *ST)
+{
+    copyBlocksToGlass(ST);
+    return ST->rows[ST->size.h - 1] != 0;
+}
+
+static int opRemoveLines(tState *ST)
+{
+    return checkRemoveFullLine(ST);
+}
+
+static int opFallStep(tState *ST)
+{
+    fallStep(ST);
+    return ST->gy;
+}
+
+static int opEvalBoard(tState *ST)
+{
+    tFeatures F;
+    evalBoards(&ST->size, ST->rows, 1, &F);
+    return F.holes;
+}
+
+static int opSaveSnapshot(tState *ST)
+{
+    return (int)saveSnapshot(ST, SNAPSHOT);
+}
+
+static int opSaveFork(tState *ST)
+{
+    return (int)saveFork(ST, FORK);
+}
+
+static int opFork(tState *ST)
+{
+    // the state is saved, then it comes back (the search explores a move in between)
+    saveFork(ST, FORK);
+    return restoreFork(ST, FORK);
+}
+
+static int opUndo(tState *ST)
+{
+    return pushUndo(&UNDO, ST) && popUndo(&UNDO, ST);
+}
+
+static const tOp OPS[] = {
+    {"checkItemLeft", opCheckLeft, AT_TOP, RESET_NONE},
+    {"checkItemRight", opCheckRight, AT_TOP, RESET_NONE},
+    {"checkItemBottom", opCheckBottom, AT_TOP, RESET_NONE},
+    {"checkItemBottom_stopped", opCheckBottom, STOPPED, RESET_NONE},
+    {"rotateItem", opRotate, AT_TOP, RESET_ITEM},
+    {"copyBlocksToGlass", opCopyBlocks, STOPPED, RESET_SNAPSHOT},
+    {"checkRemoveFullLine", opRemoveLines, LOCKED, RESET_SNAPSHOT},
+    {"fallStep", opFallStep, AT_TOP, RESET_ITEM},
+    {"fallStep_lock", opFallStep, STOPPED, RESET_SNAPSHOT},
+    {"evalBoards", opEvalBoard, LOCKED, RESET_NONE},
+    {"saveFork", opSaveFork, LOCKED, RESET_NONE},
+    {"saveFork+restoreFork", opFork, LOCKED, RESET_NONE},
+    {"saveSnapshot", opSaveSnapshot, LOCKED, RESET_NONE},
+    {"pushUndo+popUndo", opUndo, LOCKED, RESET_NONE},
+};
+#define NOPS ((int)(sizeof(OPS) / sizeof(OPS[0])))
+
+/**
+ * @brief Put the block into the glass and the bitboard
+ *
+ * @param ST : State data structure
+ * @param i : Line
+ * @param j : Column
+ * @param color : Block color
+ */
+static void setBlock(tState *ST, int i, int j, int color)
+{
+    GLASS_LINE(ST, i)[j] = (uint8_t)color;
+    ST->rows[i] |= (tRow)1 << j;
+}
+
+/**
+ * @brief Finish the fixture: spawn the item, find its final placement
+ *
+ * @param F : Fixture with the glass in F->states[AT_TOP]
+ * @param name : Fixture name
+ * @param id : Item
+ */
+static void finishFixture(tFixture *F, const char *name, int id)
+{
+    tPlacement pl[MAXPLACEMENTS];
+    tState *top = &F->states[AT_TOP];
+    F->name = name;
+    // the blocks are set directly
+    updateHeights(top);
+    spawnItem(top, id);
+    top->GAME_STATE = ITEM_FALLING;
+
+    // the placement clearing the most lines, then the lowest one
+    int n = getPlacements(top, pl, MAXPLACEMENTS);
+    int best = 0;
+    F->lines = -1;
+    for (int k = 0; k < n; k++)
+    {
+        tRow rows[GLASS_MAX_H];
+        memcpy(rows, top->rows, sizeof(rows));
+        placeItem(rows, id, &pl[k]);
+        int lines = removeFullRows(&top->size, rows);
+        if (lines > F->lines || (lines == F->lines && pl[k].gy > pl[best].gy))
+        {
+            best = k;
+            F->lines = lines;
+        }
+    }
+    F->states[STOPPED] = *top;
+    F->states[STOPPED].gx = pl[best].gx;
+    F->states[STOPPED].gy = pl[best].gy;
+    F->states[STOPPED].ROTATION = pl[best].rot;
+    F->states[LOCKED] = F->states[STOPPED];
+    lockItem(&F->states[LOCKED]);
+    for (int p = AT_TOP; p <= LOCKED; p++)
+    {
+        saveSnapshot(&F->states[p], F->snapshots[p]);
+    }
+}
+
+/**
+ * @brief Make the board fixtures: empty, half full with a well, jagged columns, filled up to the top
+ *
+ * @param fixtures : 4 fixtures
+ * @param G : Glass size
+ */
+static void makeFixtures(tFixture *fixtures, const tGlassSize *G)
+{
+    tRng R;
+    int w = G->w, h = G->h;
+    seedRandom(&R, 2024);
+    for (int f = 0; f < 4; f++)
+    {
+        memset(&fixtures[f], 0, sizeof(tFixture));
+        setGlassSize(&fixtures[f].states[AT_TOP], w, h);
+        newGame(&fixtures[f].states[AT_TOP]);
+    }
+
+    finishFixture(&fixtures[0], "empty", 6);
+
+    // half of the glass is full except the well at the left wall: the I item clears 4 lines
+    for (int i = h / 2; i < h; i++)
+    {
+        for (int j = 1; j < w; j++)
+        {
+            setBlock(&fixtures[1].states[AT_TOP], i, j, 1 + getRandomInt(&R, MAXCOLORS - 1));
+        }
+    }
+    finishFixture(&fixtures[1], "half_full", 0);
+
+    // columns of random heights up to the half of the glass
+    for (int j = 0; j < w; j++)
+    {
+        int top = h - getRandomInt(&R, h / 2 + 1);
+        for (int i = top; i < h; i++)
+        {
+            setBlock(&fixtures[2].states[AT_TOP], i, j, 1 + getRandomInt(&R, MAXCOLORS - 1));
+        }
+    }
+    finishFixture(&fixtures[2], "jagged", 4);
+
+    // filled with holes up to 4 lines under the top, the item has little room
+    for (int i = ITEMBLOCKS; i < h; i++)
+    {
+        for (int j = 0; j < w; j++)
+        {
+            if (getRandomInt(&R, 5) > 0)
+            {
+                setBlock(&fixtures[3].states[AT_TOP], i, j, 1 + getRandomInt(&R, MAXCOLORS - 1));
+            }
+        }
+    }
+    finishFixture(&fixtures[3], "near_top", 6);
+}
+
+static int compareDoubles(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+static volatile int SINK; // Results of the calls (they are not optimized out)
+
+/**
+ * @brief Time the operation on the fixture
+ *
+ * @param op : Operation
+ * @param F : Fixture
+ * @param rounds : Number of timed rounds
+ * @param iters : Calls per round
+ * @param min : Fastest round in ns per call
+ * @return double : Median round in ns per call
+ */
+static double timeOp(const tOp *op, const tFixture *F, int rounds, int iters, double *min)
+{
+    static double ns[MAXROUNDS];
+    const void *src = F->snapshots[op->pos];
+    const tState *item = &F->states[op->pos];
+    static tState ST;
+    ST = F->states[op->pos];
+    int sink = 0;
+
+    for (int r = 0; r < WARMUP + rounds; r++)
+    {
+        uint64_t start = clock_ns();
+        for (int k = 0; k < iters; k++)
+        {
+            if (op->reset == RESET_ITEM)
+            {
+                ST.gx = item->gx;
+                ST.gy = item->gy;
+                ST.ROTATION = item->ROTATION;
+                ST.GAME_STATE = item->GAME_STATE;
+            }
+            else if (op->reset == RESET_SNAPSHOT)
+            {
+                restoreSnapshot(&ST, src);
+            }
+            sink += op->run(&ST);
+        }
+        if (r >= WARMUP)
+        {
+            ns[r - WARMUP] = (double)(clock_ns() - start) / iters;
+        }
+    }
+    SINK = sink;
+    qsort(ns, (size_t)rounds, sizeof(ns[0]), compareDoubles);
+    *min = ns[0];
+    return ns[rounds / 2];
+}
+
+static void usage(const char *prog)
+{
+    printf("Usage: %s [-rounds R] [-iters N] [-glass WxH] [-csv]\n", prog);
+}
+
+/**
+ * @brief Engine microbenchmarks
+ *
+ * @param argc : Number of arguments passed to the program
+ * @param argv : Values of arguments passed to the program
+ * @return int
+ */
+int main(int argc, char **argv)
+{
+    int rounds = 21, iters = 20000;
+    bool csv = false;
+    tGlassSize G;
+    initGlassSize(&G, GLASS_W, GLASS_H);
+    for (int i = 1; i < argc; i++)
+    {
+        bool has_value = i + 1 < argc;
+        if (strcmp(argv[i], "-rounds") == 0 && has_value)
+        {
+            rounds = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-iters") == 0 && has_value)
+        {
+            iters = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-glass") == 0 && has_value && parseGlassSize(&G, argv[i + 1]))
+        {
+            i++;
+        }
+        else if (strcmp(argv[i], "-csv") == 0)
+        {
+            csv = true;
+        }
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (rounds < 1 || rounds > MAXROUNDS || iters < 1)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    static tFixture fixtures[4];
+    makeFixtures(fixtures, &G);
+    if (!initUndo(&UNDO, SNAPSHOT_MAX_SIZE + 64))
+    {
+        printf("Out of memory\n");
+        return 1;
+    }
+
+    // ns_per_op and min_ns are the median and the fastest rounds without the reset of the state (reset_ns)
+    if (csv)
+    {
+        printf("fixture,op,ns_per_op,min_ns,reset_ns,rounds,iters\n");
+    }
+    else
+    {
+        printf("glass %dx%d\n", G.w, G.h);
+    }
+    for (int f = 0; f < 4; f++)
+    {
+        if (!csv)
+        {
+            printf("%s (the item clears %d lines)\n", fixtures[f].name, fixtures[f].lines);
+        }
+        for (int o = 0; o < NOPS; o++)
+        {
+            // the reset alone, on the same fixture state as the operation
+            double min, reset_min, reset = 0.0;
+            if (OPS[o].reset != RESET_NONE)
+            {
+                const tOp op = {"reset", opReset, OPS[o].pos, OPS[o].reset};
+                reset = timeOp(&op, &fixtures[f], rounds, iters, &reset_min);
+            }
+            double med = timeOp(&OPS[o], &fixtures[f], rounds, iters, &min);
+            double net = med - reset > 0 ? med - reset : 0.0;
+            min = min - reset > 0 ? min - reset : 0.0;
+            if (csv)
+            {
+                printf("%s,%s,%.2f,%.2f,%.2f,%d,%d\n", fixtures[f].name, OPS[o].name, net, min, reset, rounds,
+                       iters);
+            }
+            else
+            {
+                printf("  %-32s %8.2f ns\n", OPS[o].name, net);
+            }
+        }
+    }
+    freeUndo(&UNDO);
+    return 0;
+}
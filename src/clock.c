@@ -0,0 +1,28 @@
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#define _POSIX_C_SOURCE 199309L
+#include <time.h>
+#endif
+
+#include "clock.h"
+
+uint64_t clock_ns(void)
+{
+#if defined(_WIN32)
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER now;
+    if (freq.QuadPart == 0)
+    {
+        QueryPerformanceFrequency(&freq);
+    }
+    QueryPerformanceCounter(&now);
+    // split to avoid overflow of now * 1e9
+    return (uint64_t)(now.QuadPart / freq.QuadPart) * 1000000000ull +
+           (uint64_t)(now.QuadPart % freq.QuadPart) * 1000000000ull / (uint64_t)freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#endif
+}
@@ -0,0 +1,13 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <stdint.h>
+
+/**
+ * @brief Return monotonic clock value (in ns since an arbitrary start)
+ *
+ * @return uint64_t : Clock value
+ */
+uint64_t clock_ns(void);
+
+#endif // CLOCK_H
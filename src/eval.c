@@ -0,0 +1,286 @@
+#include "eval.h"
+
+// Column features are computed with SIMD over the array of column heights:
+// AVX2 (16 columns per vector), SSE2 (8 columns per vector) or plain C.
+// Define EVAL_SCALAR to force the plain C version.
+#if !defined(EVAL_SCALAR) && defined(__AVX2__)
+#include <immintrin.h>
+#define EVAL_LANES 16
+#elif !defined(EVAL_SCALAR) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define EVAL_LANES 8
+#else
+#define EVAL_LANES 1
+#endif
+
+// columns rounded up to the vector size
+#define EVAL_COLS(w) (((w) + EVAL_LANES - 1) / EVAL_LANES * EVAL_LANES)
+
+// height of the walls for the well depths
+#define WALL_HEIGHT(h) ((h) * 2)
+
+// the scans take the glass size as arguments, every kernel below gets its own copy of them
+#if defined(__GNUC__) || defined(__clang__)
+#define EVAL_INLINE static inline __attribute__((always_inline))
+#elif defined(_MSC_VER)
+#define EVAL_INLINE static __forceinline
+#else
+#define EVAL_INLINE static inline
+#endif
+
+const tWeights DEFAULT_WEIGHTS = {
+    .height = -0.510066f,
+    .holes = -0.35663f,
+    .bumpiness = -0.184483f,
+    .wells = -0.05f,
+    .lines = 0.760666f,
+};
+
+/**
+ * @brief Scan the lines of the board: column heights, completed lines and holes
+ *
+ * @param rows : Occupancy bitboard of the glass
+ * @param w, h : Glass size
+ * @param full : Bitmask of the completely filled row
+ * @param heights : Column heights, at least w size (other values are not changed)
+ * @param F : Features, lines and holes are set
+ * @return int : Aggregate height
+ */
+EVAL_INLINE int scanRows(const tRow *rows, int w, int h, tRow full, int16_t *heights, tFeatures *F)
+{
+    int16_t line_height[GLASS_MAX_H];
+    int height = 0, filled = 0;
+
+    // height of each line counted from the bottom without the completed lines
+    F->lines = 0;
+    for (int i = h - 1; i >= 0; i--)
+    {
+        if (rows[i] == full)
+        {
+            F->lines++;
+            continue;
+        }
+        line_height[i] = (int16_t)(h - i - F->lines);
+        filled += countBits(rows[i]);
+    }
+
+    // column tops: the first block of the column from the top
+    for (int j = 0; j < w; j++)
+    {
+        heights[j] = 0;
+    }
+    tRow seen = 0;
+    for (int i = 0; i < h && seen != full; i++)
+    {
+        if (rows[i] == full)
+        {
+            continue;
+        }
+        uint64_t tops = rows[i] & ~seen;
+        seen |= (tRow)tops;
+        for (; tops != 0; tops &= tops - 1)
+        {
+            heights[lowestBit(tops)] = line_height[i];
+            height += line_height[i];
+        }
+    }
+
+    // every empty cell below a column top is a hole
+    F->holes = height - filled;
+    return height;
+}
+
+/**
+ * @brief Compute bumpiness and wells from the column heights
+ *
+ * @param ext : Column heights with the walls: ext[0] and ext[width + 1] are WALL_HEIGHT,
+ * EVAL_COLS(width) + EVAL_LANES + 2 size
+ * @param width : Glass width
+ * @param F : Features, bumpiness and wells are set
+ */
+EVAL_INLINE void scanColumns(const int16_t *ext, int width, tFeatures *F)
+{
+#if EVAL_LANES == 16
+    __m256i bump = _mm256_setzero_si256();
+    __m256i wells = _mm256_setzero_si256();
+    const __m256i lane = _mm256_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    for (int j = 0; j < EVAL_COLS(width); j += EVAL_LANES)
+    {
+        __m256i col = _mm256_add_epi16(lane, _mm256_set1_epi16((short)j));
+        __m256i left = _mm256_loadu_si256((const __m256i *)(ext + j));
+        __m256i mid = _mm256_loadu_si256((const __m256i *)(ext + j + 1));
+        __m256i right = _mm256_loadu_si256((const __m256i *)(ext + j + 2));
+        // |h[j] - h[j + 1]| for j < width - 1
+        __m256i in_bump = _mm256_cmpgt_epi16(_mm256_set1_epi16((short)(width - 1)), col);
+        __m256i diff = _mm256_abs_epi16(_mm256_sub_epi16(mid, right));
+        bump = _mm256_add_epi16(bump, _mm256_and_si256(diff, in_bump));
+        // max(min(h[j - 1], h[j + 1]) - h[j], 0) for j < width
+        __m256i in_glass = _mm256_cmpgt_epi16(_mm256_set1_epi16((short)width), col);
+        __m256i depth = _mm256_max_epi16(_mm256_sub_epi16(_mm256_min_epi16(left, right), mid), _mm256_setzero_si256());
+        wells = _mm256_add_epi16(wells, _mm256_and_si256(depth, in_glass));
+    }
+    // horizontal sums of 16-bit lanes
+    __m256i bsum = _mm256_madd_epi16(bump, _mm256_set1_epi16(1));
+    __m256i wsum = _mm256_madd_epi16(wells, _mm256_set1_epi16(1));
+    __m128i b = _mm_add_epi32(_mm256_castsi256_si128(bsum), _mm256_extracti128_si256(bsum, 1));
+    __m128i w = _mm_add_epi32(_mm256_castsi256_si128(wsum), _mm256_extracti128_si256(wsum, 1));
+    b = _mm_add_epi32(b, _mm_shuffle_epi32(b, _MM_SHUFFLE(1, 0, 3, 2)));
+    w = _mm_add_epi32(w, _mm_shuffle_epi32(w, _MM_SHUFFLE(1, 0, 3, 2)));
+    b = _mm_add_epi32(b, _mm_shuffle_epi32(b, _MM_SHUFFLE(2, 3, 0, 1)));
+    w = _mm_add_epi32(w, _mm_shuffle_epi32(w, _MM_SHUFFLE(2, 3, 0, 1)));
+    F->bumpiness = _mm_cvtsi128_si32(b);
+    F->wells = _mm_cvtsi128_si32(w);
+#elif EVAL_LANES == 8
+    __m128i bump = _mm_setzero_si128();
+    __m128i wells = _mm_setzero_si128();
+    const __m128i lane = _mm_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7);
+    for (int j = 0; j < EVAL_COLS(width); j += EVAL_LANES)
+    {
+        __m128i col = _mm_add_epi16(lane, _mm_set1_epi16((short)j));
+        __m128i left = _mm_loadu_si128((const __m128i *)(ext + j));
+        __m128i mid = _mm_loadu_si128((const __m128i *)(ext + j + 1));
+        __m128i right = _mm_loadu_si128((const __m128i *)(ext + j + 2));
+        // |h[j] - h[j + 1]| for j < width - 1 (SSE2 has no abs: max(a - b, b - a))
+        __m128i in_bump = _mm_cmpgt_epi16(_mm_set1_epi16((short)(width - 1)), col);
+        __m128i diff = _mm_max_epi16(_mm_sub_epi16(mid, right), _mm_sub_epi16(right, mid));
+        bump = _mm_add_epi16(bump, _mm_and_si128(diff, in_bump));
+        // max(min(h[j - 1], h[j + 1]) - h[j], 0) for j < width
+        __m128i in_glass = _mm_cmpgt_epi16(_mm_set1_epi16((short)width), col);
+        __m128i depth = _mm_max_epi16(_mm_sub_epi16(_mm_min_epi16(left, right), mid), _mm_setzero_si128());
+        wells = _mm_add_epi16(wells, _mm_and_si128(depth, in_glass));
+    }
+    // horizontal sums of 16-bit lanes
+    __m128i b = _mm_madd_epi16(bump, _mm_set1_epi16(1));
+    __m128i w = _mm_madd_epi16(wells, _mm_set1_epi16(1));
+    b = _mm_add_epi32(b, _mm_shuffle_epi32(b, _MM_SHUFFLE(1, 0, 3, 2)));
+    w = _mm_add_epi32(w, _mm_shuffle_epi32(w, _MM_SHUFFLE(1, 0, 3, 2)));
+    b = _mm_add_epi32(b, _mm_shuffle_epi32(b, _MM_SHUFFLE(2, 3, 0, 1)));
+    w = _mm_add_epi32(w, _mm_shuffle_epi32(w, _MM_SHUFFLE(2, 3, 0, 1)));
+    F->bumpiness = _mm_cvtsi128_si32(b);
+    F->wells = _mm_cvtsi128_si32(w);
+#else
+    F->bumpiness = 0;
+    F->wells = 0;
+    for (int j = 1; j <= width; j++)
+    {
+        if (j < width)
+        {
+            F->bumpiness += ext[j] > ext[j + 1] ? ext[j] - ext[j + 1] : ext[j + 1] - ext[j];
+        }
+        int side = ext[j - 1] < ext[j + 1] ? ext[j - 1] : ext[j + 1];
+        if (side > ext[j])
+        {
+            F->wells += side - ext[j];
+        }
+    }
+#endif
+}
+
+/**
+ * @brief Compute features of many boards of the glass size
+ *
+ * @param boards : n bitboards of h lines one after another
+ * @param n : Number of boards
+ * @param w, h : Glass size
+ * @param full : Bitmask of the completely filled row
+ * @param out : Features of each board
+ */
+EVAL_INLINE void evalSized(const tRow *boards, int n, int w, int h, tRow full, tFeatures *out)
+{
+    // heights with the walls on both sides, padded to the vector size
+    int16_t ext[EVAL_COLS(GLASS_MAX_W) + EVAL_LANES + 2];
+    for (int j = 0; j < EVAL_COLS(w) + EVAL_LANES + 2; j++)
+    {
+        ext[j] = (int16_t)WALL_HEIGHT(h);
+    }
+
+    for (int b = 0; b < n; b++)
+    {
+        out[b].height = scanRows(boards + (size_t)b * h, w, h, full, ext + 1, &out[b]);
+        scanColumns(ext, w, &out[b]);
+    }
+}
+
+/**
+ * @brief Board evaluation kernel of one glass size
+ *
+ */
+typedef void (*tEvalKernel)(const tGlassSize *G, const tRow *boards, int n, tFeatures *out);
+
+static void evalBoardsAny(const tGlassSize *G, const tRow *boards, int n, tFeatures *out)
+{
+    evalSized(boards, n, G->w, G->h, G->full, out);
+}
+
+// kernel of the common glass size: the line and column loops have constant bounds
+#define EVAL_KERNEL(W, H)                                                                                              \
+    static void evalBoards##W##x##H(const tGlassSize *G, const tRow *boards, int n, tFeatures *out)                    \
+    {                                                                                                                  \
+        (void)G;                                                                                                       \
+        evalSized(boards, n, W, H, FULL_ROW(W), out);                                                                  \
+    }
+
+#if GLASS_MAX_W >= 14 && GLASS_MAX_H >= 28
+EVAL_KERNEL(10, 20)
+EVAL_KERNEL(14, 28)
+#endif
+
+static const struct
+{
+    int w, h;        // Glass size
+    tEvalKernel run; // Kernel of the size
+} KERNELS[] = {
+#if GLASS_MAX_W >= 14 && GLASS_MAX_H >= 28
+    {10, 20, evalBoards10x20},
+    {14, 28, evalBoards14x28},
+#endif
+    {0, 0, evalBoardsAny},
+};
+
+/**
+ * @brief Choose the evaluation kernel of the glass size
+ *
+ * @param G : Glass size
+ * @return tEvalKernel : Specialized kernel or the one of any size
+ */
+static tEvalKernel getKernel(const tGlassSize *G)
+{
+    int k = 0;
+    while (KERNELS[k].w != 0 && (KERNELS[k].w != G->w || KERNELS[k].h != G->h))
+    {
+        k++;
+    }
+    return KERNELS[k].run;
+}
+
+void getColumnHeights(const tGlassSize *G, const tRow *rows, int16_t *heights)
+{
+    tFeatures F;
+    scanRows(rows, G->w, G->h, G->full, heights, &F);
+}
+
+void evalBoards(const tGlassSize *G, const tRow *boards, int n, tFeatures *out)
+{
+    getKernel(G)(G, boards, n, out);
+}
+
+float scoreFeatures(const tFeatures *F, const tWeights *W)
+{
+    return W->height * F->height + W->holes * F->holes + W->bumpiness * F->bumpiness + W->wells * F->wells +
+           W->lines * F->lines;
+}
+
+void scoreBoards(const tGlassSize *G, const tRow *boards, int n, const tWeights *W, float *scores)
+{
+    tFeatures F[64];
+    tEvalKernel run = getKernel(G);
+    for (int b = 0; b < n; b += 64)
+    {
+        int m = n - b < 64 ? n - b : 64;
+        run(G, boards + (size_t)b * G->h, m, F);
+        for (int k = 0; k < m; k++)
+        {
+            scores[b + k] = scoreFeatures(&F[k], W);
+        }
+    }
+}
@@ -0,0 +1,79 @@
+#ifndef EVAL_H
+#define EVAL_H
+
+// Board evaluation for bots: features of the glass and their weighted score
+
+#include "tetris_core.h"
+
+/**
+ * @brief Board features (computed as if the completed lines were removed)
+ *
+ */
+typedef struct _tfeatures
+{
+    int height;    // Aggregate height of the columns
+    int holes;     // Empty cells below the column tops
+    int bumpiness; // Sum of height differences of the neighbour columns
+    int wells;     // Sum of well depths (columns lower than both neighbours, the walls are high)
+    int lines;     // Completed lines
+} tFeatures;
+
+/**
+ * @brief Feature weights of the board score
+ *
+ */
+typedef struct _tweights
+{
+    float height;
+    float holes;
+    float bumpiness;
+    float wells;
+    float lines;
+} tWeights;
+
+/**
+ * @brief Default weights (the higher score, the better board)
+ *
+ */
+extern const tWeights DEFAULT_WEIGHTS;
+
+/**
+ * @brief Get column heights of the board (as if the completed lines were removed)
+ *
+ * @param G : Glass size
+ * @param rows : Occupancy bitboard of the glass
+ * @param heights : Column heights, G->w size
+ */
+void getColumnHeights(const tGlassSize *G, const tRow *rows, int16_t *heights);
+
+/**
+ * @brief Compute features of many boards (10x20 and 14x28 glasses have their own faster kernels)
+ *
+ * @param G : Glass size
+ * @param boards : n bitboards of G->h lines one after another
+ * @param n : Number of boards
+ * @param out : Features of each board
+ */
+void evalBoards(const tGlassSize *G, const tRow *boards, int n, tFeatures *out);
+
+/**
+ * @brief Weighted score of the board features
+ *
+ * @param F : Board features
+ * @param W : Feature weights
+ * @return float : Score (the higher, the better)
+ */
+float scoreFeatures(const tFeatures *F, const tWeights *W);
+
+/**
+ * @brief Compute scores of many boards
+ *
+ * @param G : Glass size
+ * @param boards : n bitboards of G->h lines one after another
+ * @param n : Number of boards
+ * @param W : Feature weights
+ * @param scores : Score of each board
+ */
+void scoreBoards(const tGlassSize *G, const tRow *boards, int n, const tWeights *W, float *scores);
+
+#endif // EVAL_H
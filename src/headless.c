@@ -0,0 +1,104 @@
+#include "ai.h"
+#include "policy.h"
+#include "replay.h"
+#include <stdlib.h>
+
+/**
+ * @brief Play the replay files at full speed and check the final glass
+ *
+ * @param n : Number of files
+ * @param paths : File names
+ * @return int : 0 - all replays are verified, 1 - otherwise
+ */
+static int checkReplays(int n, char **paths)
+{
+    int failed = 0;
+    tState ST;
+    for (int i = 0; i < n; i++)
+    {
+        tReplay R;
+        if (!loadReplay(&R, paths[i]))
+        {
+            printf("%s: can not be read\n", paths[i]);
+            failed++;
+            continue;
+        }
+        tReplayResult res = playReplay(R.data, R.size, &ST, NULL, NULL);
+        freeReplay(&R);
+        if (!res.valid)
+        {
+            printf("%s: invalid\n", paths[i]);
+        }
+        else
+        {
+            printf("%s: %s, %d actions, %u ms, %d items, %d lines\n", paths[i],
+                   res.verified ? "verified" : "MISMATCH", res.actions, res.time, ST.items, ST.lines);
+        }
+        failed += !res.verified;
+    }
+    return failed > 0;
+}
+
+/**
+ * @brief Headless driver: plays games with random moves or the bot without any window,
+ * or checks replays: tetris_headless replay FILE...
+ *
+ * @param argc : Number of arguments passed to the program
+ * @param argv : Values of arguments passed to the program (number of games, seed, "bag" for 7-bag items,
+ * "ai" for the bot, maximum number of items in a game, glass size WxH)
+ * @return int
+ */
+int main(int argc, char **argv)
+{
+    if (argc > 1 && strcmp(argv[1], "replay") == 0)
+    {
+        return checkReplays(argc - 2, argv + 2);
+    }
+
+    int games = argc > 1 ? atoi(argv[1]) : 1;
+    uint64_t seed = argc > 2 ? strtoull(argv[2], NULL, 10) : 1;
+    tRandomizer mode = argc > 3 && strcmp(argv[3], "bag") == 0 ? RANDOM_BAG : RANDOM_UNIFORM;
+    bool bot = argc > 4 && strcmp(argv[4], "ai") == 0;
+    int max_items = argc > 5 ? atoi(argv[5]) : 0;
+    long total_items = 0, total_lines = 0;
+    tState ST;
+    tRng moves;
+    tAI AI;
+
+    if (!setGlassSize(&ST, GLASS_W, GLASS_H) || (argc > 6 && !parseGlassSize(&ST.size, argv[6])))
+    {
+        printf("Wrong glass size: %s (WxH up to %dx%d)\n", argv[6], GLASS_MAX_W, GLASS_MAX_H);
+        return 1;
+    }
+    if (bot && !initAI(&AI, &ST.size, 3, 32, 16))
+    {
+        printf("Error initializing the bot\n");
+        return 1;
+    }
+
+    for (int g = 0; g < games; g++)
+    {
+        // game g is reproduced by the same seed + g
+        initRandomizer(&ST, seed + g, mode);
+        seedRandom(&moves, ~(seed + g));
+        if (bot)
+        {
+            playGame(&ST, policyAI, &AI, max_items);
+        }
+        else
+        {
+            playGame(&ST, policyRandom, &moves, max_items);
+        }
+        printf("game %d: %d items, %d lines\n", g, ST.items, ST.lines);
+        total_items += ST.items;
+        total_lines += ST.lines;
+    }
+    printf("%d games, %ld items, %ld lines\n", games, total_items, total_lines);
+    if (bot)
+    {
+        printf("bot: %ld boards, %ld merged, %ld scores from the table, %zu KB of the search arena used\n", AI.searched,
+               AI.merged, AI.cached, AI.arena_peak / 1024);
+        freeAI(&AI);
+    }
+    return 0;
+}
@@ -0,0 +1,99 @@
+#include "log.h"
+#include "clock.h"
+#include <stdarg.h>
+#include <stdio.h>
+
+static tLogger LOG;
+
+static const char* LEVEL_NAMES[] = {"DEBUG", "INFO", "WARN", "ERROR"};
+
+/**
+ * @brief Write the record to stdout
+ *
+ * @param R : Record
+ */
+static void printRecord(const tLogRecord* R)
+{
+    printf("[%8.3f] %-5s %s\n", (R->time - LOG.start) / 1e9, LEVEL_NAMES[R->level], R->text);
+}
+
+/**
+ * @brief Writer thread: writes out the records till the stop, then the rest of them
+ *
+ * @param data : Not used
+ * @return int
+ */
+static int writeRecords(void* data)
+{
+    (void)data;
+    for (;;)
+    {
+        // read stop before the records: nothing written before the stop is lost
+        bool stop = SDL_AtomicGet(&LOG.stop) != 0;
+        int tail = SDL_AtomicGet(&LOG.tail);
+        int head = SDL_AtomicGet(&LOG.head);
+        for (; tail != head; tail++)
+        {
+            printRecord(&LOG.records[tail & (LOG_RECORDS - 1)]);
+        }
+        // the slots are free after the text is printed
+        SDL_AtomicSet(&LOG.tail, tail);
+        fflush(stdout);
+        if (stop)
+        {
+            return 0;
+        }
+        SDL_Delay(LOG_POLL_MS);
+    }
+}
+
+bool startLog(void)
+{
+    LOG.start = clock_ns();
+    LOG.thread = SDL_CreateThread(writeRecords, "log", NULL);
+    return LOG.thread != NULL;
+}
+
+void stopLog(void)
+{
+    if (LOG.thread)
+    {
+        SDL_AtomicSet(&LOG.stop, 1);
+        SDL_WaitThread(LOG.thread, NULL);
+        LOG.thread = NULL;
+    }
+    if (LOG.dropped > 0)
+    {
+        printf("log: %d records dropped\n", LOG.dropped);
+    }
+    fflush(stdout);
+}
+
+void logWrite(int level, const char* fmt, ...)
+{
+    tLogRecord local;
+    int head = SDL_AtomicGet(&LOG.head);
+    bool async = LOG.thread != NULL;
+    if (async && head - SDL_AtomicGet(&LOG.tail) == LOG_RECORDS)
+    {
+        // the frame does not wait for the console
+        LOG.dropped++;
+        return;
+    }
+    tLogRecord* R = async ? &LOG.records[head & (LOG_RECORDS - 1)] : &local;
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(R->text, sizeof(R->text), fmt, args);
+    va_end(args);
+    R->time = clock_ns();
+    R->level = level < LEVEL_DEBUG ? LEVEL_DEBUG : level > LEVEL_ERROR ? LEVEL_ERROR : level;
+    if (async)
+    {
+        // publish the record (SDL_AtomicSet is a full barrier)
+        SDL_AtomicSet(&LOG.head, head + 1);
+    }
+    else
+    {
+        printRecord(R);
+    }
+}
@@ -0,0 +1,98 @@
+#ifndef LOG_H
+#define LOG_H
+
+// Leveled logger: the game loop formats a record into a ring buffer, a background thread writes it out,
+// so a slow console does not stall the frame. The levels under LOG_MIN_LEVEL are removed at compile time.
+
+#include <SDL.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define LEVEL_DEBUG 0
+#define LEVEL_INFO 1
+#define LEVEL_WARN 2
+#define LEVEL_ERROR 3
+
+// release builds (NDEBUG) have no debug records, -DLOG_MIN_LEVEL=N overrides it
+#ifndef LOG_MIN_LEVEL
+#ifdef NDEBUG
+#define LOG_MIN_LEVEL LEVEL_INFO
+#else
+#define LOG_MIN_LEVEL LEVEL_DEBUG
+#endif
+#endif
+
+#define LOG_RECORDS 256 // Ring buffer size in records (power of 2)
+#define LOG_LINE 120    // Maximum length of a record text
+#define LOG_POLL_MS 5   // Writer thread sleep when the ring buffer is empty
+
+/**
+ * @brief Log record: formatted by the game loop, written by the writer thread
+ *
+ */
+typedef struct _tlogrecord
+{
+    uint64_t time;       // clock_ns() of the record
+    int level;           // Record level
+    char text[LOG_LINE]; // Formatted text
+} tLogRecord;
+
+/**
+ * @brief Logger data structure (single producer: the main thread, single consumer: the writer thread)
+ *
+ */
+typedef struct _tlogger
+{
+    tLogRecord records[LOG_RECORDS]; // Ring buffer
+    SDL_atomic_t head;               // Records written by the producer (only it changes it)
+    SDL_atomic_t tail;               // Records written out by the consumer (only it changes it)
+    SDL_atomic_t stop;               // The writer thread drains the buffer and exits
+    SDL_Thread *thread;              // Writer thread (NULL - records are written at once)
+    uint64_t start;                  // clock_ns() of the logger start
+    int dropped;                     // Records dropped because the buffer was full
+} tLogger;
+
+/**
+ * @brief Start the writer thread (without it the records are written synchronously)
+ *
+ * @return true : The thread is started
+ * @return false : The records are written synchronously
+ */
+bool startLog(void);
+
+/**
+ * @brief Write out all records and stop the writer thread
+ *
+ */
+void stopLog(void);
+
+/**
+ * @brief Format the record into the ring buffer (never waits: the record is dropped when the buffer is full)
+ *
+ * @param level : Record level
+ * @param fmt : printf() format
+ * @param ... : Format arguments
+ */
+void logWrite(int level, const char *fmt, ...);
+
+#if LOG_MIN_LEVEL <= LEVEL_DEBUG
+#define LOG_DEBUG(...) logWrite(LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) ((void)0)
+#endif
+
+#if LOG_MIN_LEVEL <= LEVEL_INFO
+#define LOG_INFO(...) logWrite(LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...) ((void)0)
+#endif
+
+#if LOG_MIN_LEVEL <= LEVEL_WARN
+#define LOG_WARN(...) logWrite(LEVEL_WARN, __VA_ARGS__)
+#else
+#define LOG_WARN(...) ((void)0)
+#endif
+
+#define LOG_ERROR(...) logWrite(LEVEL_ERROR, __VA_ARGS__)
+
+#endif // LOG_H
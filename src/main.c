@@ -1,5 +1,10 @@
 #include "tetris.h"
+#include "replay.h"
 #include <string.h>
+#include <time.h>
+
+// game time does not run faster than this per loop (the program was paused, the window was dragged)
+#define MAX_LAG_NS 1000000000ull
 
 /**
  * @brief Main program
@@ -10,97 +15,92 @@
  */
 int main(int argc, char **argv)
 {
+    // the log records are written out by a background thread
+    startLog();
+
+    // SDL_Delay() and SDL_WaitEventTimeout() wake up within 1 ms (timeBeginPeriod(1) on Windows)
+    SDL_SetHint(SDL_HINT_TIMER_RESOLUTION, "1");
+
     /* Initializes the timer, audio, video, joystick,
     haptic, gamecontroller and events subsystems */
     if (SDL_Init(SDL_INIT_EVERYTHING) != 0)
     {
-        printf("Error initializing SDL: %s\n", SDL_GetError());
+        LOG_ERROR("Error initializing SDL: %s", SDL_GetError());
+        stopLog();
         return 0;
     }
 
     // Initialize SDL_ttf
     if (TTF_Init() == -1) {
-        printf("TTF_Init: %s\n", TTF_GetError());
+        LOG_ERROR("TTF_Init: %s", TTF_GetError());
         SDL_Quit();
+        stopLog();
         return 0;
     }
 
     // Acquire display parameters
-    int nDispModes = SDL_GetNumDisplayModes(0);
-
     SDL_DisplayMode DM;
 
+#if LOG_MIN_LEVEL <= LEVEL_DEBUG
+    // the list of the display modes is only logged
+    int nDispModes = SDL_GetNumDisplayModes(0);
     for (int i = 0; i < nDispModes; i++)
     {
         SDL_GetDisplayMode(0, i, &DM);
-        int w = DM.w;
-        int h = DM.h;
-        int rr = DM.refresh_rate;
-        printf("==   %d         %d   %d   %d\n", i, w, h, rr);
+        LOG_DEBUG("==   %d         %d   %d   %d", i, DM.w, DM.h, DM.refresh_rate);
     }
-
+#endif
 
     SDL_GetCurrentDisplayMode(0, &DM);
-    printf("==  current    %d   %d   %d\n", DM.w, DM.h, DM.refresh_rate);
+    LOG_DEBUG("==  current    %d   %d   %d", DM.w, DM.h, DM.refresh_rate);
 
     tConfig CONF;
     memset(&CONF, 0, sizeof(CONF));
     CONF.w = 1200;
     CONF.h = 800;
-    CONF.x = (DM.w - CONF.w) / 2;
-    CONF.y = (DM.h - CONF.h) / 2;
-    printf("%d   %d    %d    %d\n",CONF.x,CONF.y,CONF.w,CONF.h);
+    CONF.depth = 3;
+    CONF.beam = 32;
+    CONF.das_ms = 170;
+    CONF.arr_ms = 50;
+    initGlassSize(&CONF.glass, GLASS_W, GLASS_H);
+    parse_args(argc, argv, &CONF, &DM);
+    LOG_DEBUG("%d   %d    %d    %d",CONF.x,CONF.y,CONF.w,CONF.h);
 
-    tState ST = {.colors = {{0, 0, 0},      // transparent
-                            {228, 26, 28},  // red
-                            {255, 255, 51}, // yellow
-                            {255, 127, 0},  // orange
-                            {77, 175, 74},  // green
-                            {152, 78, 163}, // violet
-                            {80, 80, 80}},  // gray
-                 .items = {{0, 1, 0, 0,     //
-                            0, 1, 0, 0,     //
-                            0, 1, 0, 0,     //
-                            0, 1, 0, 0},    // I
-                           {0, 0, 0, 0,     //
-                            0, 2, 2, 0,     //
-                            0, 2, 2, 0,     //
-                            0, 0, 0, 0},    // O
-                           {0, 0, 0, 0,     //
-                            0, 3, 0, 0,     //
-                            0, 3, 0, 0,     //
-                            0, 3, 3, 0},    // L
-                           {0, 0, 0, 0,     //
-                            0, 0, 3, 0,     //
-                            0, 0, 3, 0,     //
-                            0, 3, 3, 0},    // J
-                           {0, 0, 0, 0,     //
-                            0, 4, 0, 0,     //
-                            0, 4, 4, 0,     //
-                            0, 0, 4, 0},    // S
-                           {0, 0, 0, 0,     //
-                            0, 0, 4, 0,     //
-                            0, 4, 4, 0,     //
-                            0, 4, 0, 0},    // 4
-                           {0, 0, 0, 0,     //
-                            0, 5, 0, 0,     //
-                            5, 5, 5, 0,     //
-                            0, 0, 0, 0}},   // T
-                 .fps = 60,
-                 .block_size = 25,
-                 .GAME_STATE = GAME_WELCOME,
-                 .TIMER_FPS = {0, 1000 / ST.fps},
-                 .TIMER_1 = {0, 1000},
-                 .TIMER_2 = {0, 75},
-                 .ITEM_ID = -1};
+    tView VW;
+    initView(&VW, CONF.w, CONF.h, &CONF.glass);
+
+    // game timers: slow falling 1000 ms, fast falling 75 ms, spawn delay 500 ms
+    tGameClock CLK;
+    initClock(&CLK, 1000, 75, 500);
+    uint64_t game_ns = 0, last_ns = clock_ns();
+    tReplay REPLAY = {0};
+
+    // auto-repeat of the held LEFT / RIGHT keys on the real time, not on the frames
+    tAutoShift SHIFT;
+    initAutoShift(&SHIFT, (uint32_t)CONF.das_ms, (uint32_t)CONF.arr_ms);
+
+    // phase timings of the main loop (large: not on the stack)
+    static tProfiler PROF;
+    initProfiler(&PROF);
+
+    tState ST = {.GAME_STATE = GAME_WELCOME, .ITEM_ID = -1};
+    setGlassSize(&ST, CONF.glass.w, CONF.glass.h);
+
+    tAI AI;
+    if (CONF.autoplay && !initAI(&AI, &ST.size, CONF.depth, CONF.beam, 16))
+    {
+        LOG_ERROR("Error initializing the bot (depth %d, beam %d)", CONF.depth, CONF.beam);
+        CONF.autoplay = false;
+    }
 
     /* Create a window */
     uint32_t flags = 0;
     SDL_Window *wind = SDL_CreateWindow("TETRIS", CONF.x, CONF.y, CONF.w, CONF.h, flags);
     if (!wind)
     {
-        printf("Error creating window: %s\n", SDL_GetError());
+        LOG_ERROR("Error creating window: %s", SDL_GetError());
         SDL_Quit();
+        stopLog();
         return 0;
     }
 
@@ -109,30 +109,39 @@ int main(int argc, char **argv)
     SDL_Renderer *rend = SDL_CreateRenderer(wind, -1, render_flags);
     if (!rend)
     {
-        printf("Error creating renderer: %s\n", SDL_GetError());
+        LOG_ERROR("Error creating renderer: %s", SDL_GetError());
         SDL_DestroyWindow(wind);
         SDL_Quit();
+        stopLog();
         return 0;
     }
+    /* Open fonts and prepare the text */
+    const int font_sizes[] = {TITLE_FONT_SIZE, SUBTITLE_FONT_SIZE, HUD_FONT_SIZE};
+    if (initTextCache(&VW.TEXT, rend, FONT_PATH, font_sizes, 3))
+    {
+        buildGlyphAtlas(&VW.TEXT, HUD_FONT_SIZE);
+    }
+    else
+    {
+        // the game still works without text
+        LOG_ERROR("Error opening font %s: %s", FONT_PATH, TTF_GetError());
+    }
+
     /* Main loop */
     bool running = true;
-    bool put_pressed = false, left_pressed = false, right_pressed = false, up_pressed = false;
-    bool put_processed = false, left_processed = false, right_processed = false, up_processed = false;
-    SDL_Rect rectScr = {0, 0, CONF.w, CONF.h};
+    tInputQueue INPUT = {0};
+    tAction action;
     SDL_Event event;
+    uint64_t event_ns;
+    int lines;
 
-    ST.glass_w = GLASS_W * ST.block_size;
-    ST.glass_h = GLASS_H * ST.block_size;
-    ST.glass_x = (CONF.w - ST.glass_w) / 2;
-    ST.glass_y = (CONF.h - ST.glass_h) / 2;
-
-    timer_start(&ST.TIMER_FPS);
-    timer_start(&ST.TIMER_1);
-    timer_start(&ST.TIMER_2);
+    timer_start(&VW.TIMER_FPS);
+    uint64_t t, last_frame = 0;
 
     while (running)
     {
         /* Process events */
+        t = clock_ns();
         while (SDL_PollEvent(&event))
         {
             switch (event.type)
@@ -140,55 +149,81 @@ int main(int argc, char **argv)
             case SDL_QUIT:
                 running = false;
                 break;
+            case SDL_RENDER_TARGETS_RESET:
+                // the contents of the cached glass layer are lost
+                invalidateGlass(&VW);
+                break;
+            case SDL_RENDER_DEVICE_RESET:
+                // all textures are lost: the glass layer is created again by drawGlass()
+                freeGlass(&VW);
+                if (!reloadTextCache(&VW.TEXT))
+                {
+                    LOG_ERROR("Error rebuilding the glyph atlas: %s", SDL_GetError());
+                }
+                break;
             case SDL_KEYDOWN:
+                if (event.key.repeat)
+                {
+                    // one action per key press, the held keys repeat by SHIFT
+                    break;
+                }
+                event_ns = getEventTime(event.key.timestamp, clock_ns());
                 switch (event.key.keysym.scancode)
                 {
                 case SDL_SCANCODE_Q:
                     running = false;
                     break;
+                case SDL_SCANCODE_F3:
+                    CONF.overlay = !CONF.overlay;
+                    break;
                 case SDL_SCANCODE_SPACE:
-                    if (ST.GAME_STATE == GAME_WELCOME) {
+                    if (ST.GAME_STATE == GAME_WELCOME)
+                    {
                         ST.GAME_STATE = GAME_STARTED;
                     }
-                    put_pressed = true;
+                    else
+                    {
+                        pushInput(&INPUT, ACTION_HARD_DROP);
+                    }
+                    break;
+                case SDL_SCANCODE_S:
+                case SDL_SCANCODE_DOWN:
+                    pushInput(&INPUT, ACTION_DROP);
                     break;
                 case SDL_SCANCODE_A:
                 case SDL_SCANCODE_LEFT:
-                    left_pressed = true;
+                    pushShiftRepeats(&INPUT, &SHIFT, event_ns, ST.size.w);
+                    pushInput(&INPUT, ACTION_LEFT);
+                    pressShift(&SHIFT, ACTION_LEFT, event_ns);
                     break;
                 case SDL_SCANCODE_D:
                 case SDL_SCANCODE_RIGHT:
-                    right_pressed = true;
+                    pushShiftRepeats(&INPUT, &SHIFT, event_ns, ST.size.w);
+                    pushInput(&INPUT, ACTION_RIGHT);
+                    pressShift(&SHIFT, ACTION_RIGHT, event_ns);
                     break;
                 case SDL_SCANCODE_W:
                 case SDL_SCANCODE_UP:
-                    up_pressed = true;
+                    pushInput(&INPUT, ACTION_ROTATE);
                     break;
                 default:
                     break;
                 }
                 break;
             case SDL_KEYUP:
+                // the moves repeated before the release are not lost
+                event_ns = getEventTime(event.key.timestamp, clock_ns());
                 switch (event.key.keysym.scancode)
                 {
-                case SDL_SCANCODE_SPACE:
-                    put_pressed = false;
-                    put_processed = false;
-                    break;
                 case SDL_SCANCODE_A:
                 case SDL_SCANCODE_LEFT:
-                    left_pressed = false;
-                    left_processed = false;
+                    pushShiftRepeats(&INPUT, &SHIFT, event_ns, ST.size.w);
+                    releaseShift(&SHIFT, ACTION_LEFT, event_ns);
                     break;
                 case SDL_SCANCODE_D:
                 case SDL_SCANCODE_RIGHT:
-                    right_pressed = false;
-                    right_processed = false;
-                    break;
-                case SDL_SCANCODE_W:
-                case SDL_SCANCODE_UP:
-                    up_pressed = false;
-                    up_processed = false;
+                    pushShiftRepeats(&INPUT, &SHIFT, event_ns, ST.size.w);
+                    releaseShift(&SHIFT, ACTION_RIGHT, event_ns);
                     break;
                 default:
                     break;
@@ -199,153 +234,150 @@ int main(int argc, char **argv)
             }
         }
 
-        // Processing
-        // TIMER_FPS handling (1000/60 ms)
-        if (is_timer_tick(&ST.TIMER_FPS))
+        // Processing: the game timers run on the game time, the missed ticks are caught up without drift
+        // (a lag over 1 s is dropped: the game pauses instead of jumping)
+        uint64_t now_ns = endPhase(&PROF, PHASE_EVENTS, t);
+        t = now_ns;
+        game_ns += now_ns - last_ns < MAX_LAG_NS ? now_ns - last_ns : MAX_LAG_NS;
+        last_ns = now_ns;
+
+        if (ST.GAME_STATE == GAME_STARTED)
         {
-            // Process slow timers
-            // TIMER_1 handling (1000 ms)
-            if (is_timer_tick(&ST.TIMER_1))
+            tReplayHeader header = {.glass_w = (uint8_t)ST.size.w,
+                                    .glass_h = (uint8_t)ST.size.h,
+                                    .randomizer = RANDOM_UNIFORM,
+                                    .seed = (uint64_t)time(NULL),
+                                    .fall_ms = (uint16_t)CLK.fall_ms,
+                                    .fast_ms = (uint16_t)CLK.fast_ms,
+                                    .spawn_ms = (uint16_t)CLK.spawn_ms};
+            initRandomizer(&ST, header.seed, (tRandomizer)header.randomizer);
+            startTimedGame(&ST, &CLK);
+            game_ns = 0;
+            clearInput(&INPUT);
+            if (CONF.record[0])
             {
-                printf("%s\n", getGameState(ST.GAME_STATE));
-                switch (ST.GAME_STATE)
-                {
-                case GAME_WELCOME:
-                    break;
-                case GAME_STARTED:
-                    break;
-                case ITEM_STARTED:
-                    break;
-                case ITEM_FALLING:
-                    fallStep(&ST);
-                    break;
-                case ITEM_FALLING_FAST:
-                    break;
-                case ITEM_STOPPED:
-                    break;
-                case GAME_FINISHED:
-                    break;
-                }
-
-                timer_start(&ST.TIMER_1);
+                freeReplay(&REPLAY);
+                startReplay(&REPLAY, &header);
             }
+        }
+
+        lines = ST.lines;
+        advanceGame(&ST, &CLK, (uint32_t)(game_ns / 1000000));
+        if (ST.lines > lines)
+        {
+            LOG_DEBUG("full lines: %d", ST.lines - lines);
+        }
 
-            // TIMER_2 handling (100 ms)
-            if (is_timer_tick(&ST.TIMER_2))
+        // Player actions, the keys pressed during the spawn delay are applied to the new item
+        // (a key held through the delay moves the new item by the repeats due, up to the wall)
+        if (ST.GAME_STATE == ITEM_FALLING || ST.GAME_STATE == ITEM_FALLING_FAST)
+        {
+            while (popInput(&INPUT, &action))
             {
-                printf("%s\n", getGameState(ST.GAME_STATE));
-                switch (ST.GAME_STATE)
+                applyAction(&ST, action);
+                recordAction(&REPLAY, CLK.now, action);
+            }
+            for (int n = takeShiftRepeats(&SHIFT, now_ns, ST.size.w); n > 0; n--)
+            {
+                // the repeats against the wall are not recorded
+                if (!applyAction(&ST, SHIFT.held))
                 {
-                case GAME_WELCOME:
-                    break;
-                case GAME_STARTED:
-                    break;
-                case ITEM_STARTED:
-                    break;
-                case ITEM_FALLING:
-                    break;
-                case ITEM_FALLING_FAST:
-                    fallStep(&ST);
-                    break;
-                case ITEM_STOPPED:
-                    if (!checkRemoveFullLine(&ST))
-                    {
-                        ST.GAME_STATE = ITEM_STARTED;
-                    }
-                    break;
-                case GAME_FINISHED:
                     break;
                 }
+                recordAction(&REPLAY, CLK.now, SHIFT.held);
+            }
+        }
 
-                timer_start(&ST.TIMER_2);
+        if (ST.GAME_STATE == GAME_FINISHED && REPLAY.data && !REPLAY.finished)
+        {
+            finishReplay(&REPLAY, CLK.now, &ST);
+            if (saveReplay(&REPLAY, CONF.record))
+            {
+                LOG_INFO("replay saved: %s (%u bytes)", CONF.record, (unsigned)REPLAY.size);
             }
+        }
 
-            // Process FPS timer
-            /* Clear screen */
-            SDL_SetRenderDrawColor(rend, ST.colors[6][0], ST.colors[6][1], ST.colors[6][2], 255);
-            SDL_RenderFillRect(rend, &rectScr);
+        t = endPhase(&PROF, PHASE_LOGIC, t);
 
-            /* Draw glass */
-            drawGlass(rend, &ST);
+        // TIMER_FPS handling (1000/60 ms)
+        if (is_timer_tick(&VW.TIMER_FPS))
+        {
+            // the missed frames are not drawn
+            timer_sync(&VW.TIMER_FPS);
 
-            switch (ST.GAME_STATE)
+            if (CONF.autoplay && ST.GAME_STATE == ITEM_FALLING)
             {
-            case GAME_WELCOME:
-                drawWelcomeScreen(rend, &ST);
-                break;
-            case GAME_STARTED:
-                clearGlass(&ST);
-                ST.GAME_STATE = ITEM_STARTED;
-                break;
-            case ITEM_STARTED:
-                ST.ITEM_ID = rand() % 7;
-                ST.x = (CONF.w - ITEMBLOCKS * ST.block_size) / 2;
-                ST.y = ITEMBLOCKS * ST.block_size / 2;
-                // init item margins
-                getLeftMargins(&ST);
-                getRightMargins(&ST);
-                getBottomMargins(&ST);
-                // update state
-                updState(&ST);
-                drawItem(rend, ST.x, ST.y, &ST);
-                SDL_Delay(500);
-                ST.GAME_STATE = ITEM_FALLING;
-                break;
-            case ITEM_FALLING:
-            case ITEM_FALLING_FAST:
-                if (left_pressed && !left_processed)
-                {
-                    if (!checkItemLeft(&ST))
-                    {
-                        ST.x -= ST.block_size;
-                        updState(&ST);
-                    }
-                    left_processed = true;
-                }
-                if (right_pressed && !right_processed)
-                {
-                    if (!checkItemRight(&ST))
-                    {
-                        ST.x += ST.block_size;
-                        updState(&ST);
-                    }
-                    right_processed = true;
-                }
-                if (up_pressed && !up_processed)
-                {
-                    rotateItem(&ST);
-                    updState(&ST);
-                    up_processed = true;
-                }
-                if (put_pressed && !put_processed)
+                // one bot action per frame
+                action = policyAI(&ST, &AI);
+                if (applyAction(&ST, action))
                 {
-                    ST.GAME_STATE = ITEM_FALLING_FAST;
-                    put_processed = true;
+                    recordAction(&REPLAY, CLK.now, action);
                 }
-                drawItem(rend, ST.x, ST.y, &ST);
-                break;
-            case ITEM_STOPPED:
-                drawItem(rend, ST.x, ST.y, &ST);
-                break;
-            case GAME_FINISHED:
-                break;
+                endPhase(&PROF, PHASE_BOT, t);
+            }
+
+            drawFrame(rend, &VW, &ST, &PROF);
+            if (CONF.overlay)
+            {
+                drawProfiler(rend, &VW, &PROF);
             }
 
             /* Draw to window and loop */
+            t = clock_ns();
             SDL_RenderPresent(rend);
-
-            timer_start(&ST.TIMER_FPS);
+            t = endPhase(&PROF, PHASE_PRESENT, t);
+            if (last_frame)
+            {
+                addSample(&PROF, PHASE_FRAME, t - last_frame);
+            }
+            last_frame = t;
         }
         else
         {
-            SDL_Delay(1);
+            // sleep till the nearest tick or repeated move, a key event wakes the loop up at once
+            uint64_t next = VW.TIMER_FPS.next;
+            uint64_t tick_ns = (uint64_t)getNextTick(&ST, &CLK) * 1000000;
+            uint64_t shift_ns = getNextShift(&SHIFT);
+            if (tick_ns > game_ns && now_ns + (tick_ns - game_ns) < next)
+            {
+                next = now_ns + (tick_ns - game_ns);
+            }
+            if (shift_ns > now_ns && shift_ns < next)
+            {
+                next = shift_ns;
+            }
+            timer_wait_event_until(next);
         }
     }
 
     /* Release resources */
+    if (REPLAY.data && !REPLAY.finished && finishReplay(&REPLAY, CLK.now, &ST))
+    {
+        // the game is not finished, save it as it is
+        saveReplay(&REPLAY, CONF.record);
+    }
+    freeReplay(&REPLAY);
+    if (CONF.profile[0])
+    {
+        if (saveProfile(&PROF, CONF.profile))
+        {
+            LOG_INFO("profile saved: %s", CONF.profile);
+        }
+        else
+        {
+            LOG_ERROR("Error writing profile %s", CONF.profile);
+        }
+    }
+    freeTextCache(&VW.TEXT);
+    freeGlass(&VW);
+    if (CONF.autoplay)
+    {
+        freeAI(&AI);
+    }
     TTF_Quit();
     SDL_DestroyRenderer(rend);
     SDL_DestroyWindow(wind);
     SDL_Quit();
+    stopLog();
     return 0;
 }
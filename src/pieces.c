@@ -0,0 +1,194 @@
+// Generated by tools/genpieces.c, do not edit
+#include "tetris_core.h"
+
+const tPiece PIECES[MAXITEMS][ROTATIONS] = {
+    // I
+    {
+        {.blocks = {0, 1, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0},
+         .marg_left = {1, 1, 1, 1},
+         .marg_right = {1, 1, 1, 1},
+         .marg_bottom = {-1, 3, -1, -1},
+         .rows = {1, 1, 1, 1},
+         .left = 1, .right = 1, .top = 0, .bottom = 3, .shape = 0},
+        {.blocks = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 0, 0, 0, 0},
+         .marg_left = {4, 4, 0, 4},
+         .marg_right = {-1, -1, 3, -1},
+         .marg_bottom = {2, 2, 2, 2},
+         .rows = {0, 0, 15, 0},
+         .left = 0, .right = 3, .top = 2, .bottom = 2, .shape = 1},
+        {.blocks = {0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 1, 0},
+         .marg_left = {2, 2, 2, 2},
+         .marg_right = {2, 2, 2, 2},
+         .marg_bottom = {-1, -1, 3, -1},
+         .rows = {1, 1, 1, 1},
+         .left = 2, .right = 2, .top = 0, .bottom = 3, .shape = 0},
+        {.blocks = {0, 0, 0, 0, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0},
+         .marg_left = {4, 0, 4, 4},
+         .marg_right = {-1, 3, -1, -1},
+         .marg_bottom = {1, 1, 1, 1},
+         .rows = {0, 15, 0, 0},
+         .left = 0, .right = 3, .top = 1, .bottom = 1, .shape = 1}
+    },
+    // O
+    {
+        {.blocks = {0, 0, 0, 0, 0, 2, 2, 0, 0, 2, 2, 0, 0, 0, 0, 0},
+         .marg_left = {4, 1, 1, 4},
+         .marg_right = {-1, 2, 2, -1},
+         .marg_bottom = {-1, 2, 2, -1},
+         .rows = {0, 3, 3, 0},
+         .left = 1, .right = 2, .top = 1, .bottom = 2, .shape = 0},
+        {.blocks = {0, 0, 0, 0, 0, 2, 2, 0, 0, 2, 2, 0, 0, 0, 0, 0},
+         .marg_left = {4, 1, 1, 4},
+         .marg_right = {-1, 2, 2, -1},
+         .marg_bottom = {-1, 2, 2, -1},
+         .rows = {0, 3, 3, 0},
+         .left = 1, .right = 2, .top = 1, .bottom = 2, .shape = 0},
+        {.blocks = {0, 0, 0, 0, 0, 2, 2, 0, 0, 2, 2, 0, 0, 0, 0, 0},
+         .marg_left = {4, 1, 1, 4},
+         .marg_right = {-1, 2, 2, -1},
+         .marg_bottom = {-1, 2, 2, -1},
+         .rows = {0, 3, 3, 0},
+         .left = 1, .right = 2, .top = 1, .bottom = 2, .shape = 0},
+        {.blocks = {0, 0, 0, 0, 0, 2, 2, 0, 0, 2, 2, 0, 0, 0, 0, 0},
+         .marg_left = {4, 1, 1, 4},
+         .marg_right = {-1, 2, 2, -1},
+         .marg_bottom = {-1, 2, 2, -1},
+         .rows = {0, 3, 3, 0},
+         .left = 1, .right = 2, .top = 1, .bottom = 2, .shape = 0}
+    },
+    // L
+    {
+        {.blocks = {0, 0, 0, 0, 0, 3, 0, 0, 0, 3, 0, 0, 0, 3, 3, 0},
+         .marg_left = {4, 1, 1, 1},
+         .marg_right = {-1, 1, 1, 2},
+         .marg_bottom = {-1, 3, 3, -1},
+         .rows = {0, 1, 1, 3},
+         .left = 1, .right = 2, .top = 1, .bottom = 3, .shape = 0},
+        {.blocks = {0, 0, 0, 0, 0, 0, 0, 3, 0, 3, 3, 3, 0, 0, 0, 0},
+         .marg_left = {4, 3, 1, 4},
+         .marg_right = {-1, 3, 3, -1},
+         .marg_bottom = {-1, 2, 2, 2},
+         .rows = {0, 4, 7, 0},
+         .left = 1, .right = 3, .top = 1, .bottom = 2, .shape = 1},
+        {.blocks = {0, 3, 3, 0, 0, 0, 3, 0, 0, 0, 3, 0, 0, 0, 0, 0},
+         .marg_left = {1, 2, 2, 4},
+         .marg_right = {2, 2, 2, -1},
+         .marg_bottom = {-1, 0, 2, -1},
+         .rows = {3, 2, 2, 0},
+         .left = 1, .right = 2, .top = 0, .bottom = 2, .shape = 2},
+        {.blocks = {0, 0, 0, 0, 3, 3, 3, 0, 3, 0, 0, 0, 0, 0, 0, 0},
+         .marg_left = {4, 0, 0, 4},
+         .marg_right = {-1, 2, 0, -1},
+         .marg_bottom = {2, 1, 1, -1},
+         .rows = {0, 7, 1, 0},
+         .left = 0, .right = 2, .top = 1, .bottom = 2, .shape = 3}
+    },
+    // J
+    {
+        {.blocks = {0, 0, 0, 0, 0, 0, 3, 0, 0, 0, 3, 0, 0, 3, 3, 0},
+         .marg_left = {4, 2, 2, 1},
+         .marg_right = {-1, 2, 2, 2},
+         .marg_bottom = {-1, 3, 3, -1},
+         .rows = {0, 2, 2, 3},
+         .left = 1, .right = 2, .top = 1, .bottom = 3, .shape = 0},
+        {.blocks = {0, 0, 0, 0, 0, 3, 3, 3, 0, 0, 0, 3, 0, 0, 0, 0},
+         .marg_left = {4, 1, 3, 4},
+         .marg_right = {-1, 3, 3, -1},
+         .marg_bottom = {-1, 1, 1, 2},
+         .rows = {0, 7, 4, 0},
+         .left = 1, .right = 3, .top = 1, .bottom = 2, .shape = 1},
+        {.blocks = {0, 3, 3, 0, 0, 3, 0, 0, 0, 3, 0, 0, 0, 0, 0, 0},
+         .marg_left = {1, 1, 1, 4},
+         .marg_right = {2, 1, 1, -1},
+         .marg_bottom = {-1, 2, 0, -1},
+         .rows = {3, 1, 1, 0},
+         .left = 1, .right = 2, .top = 0, .bottom = 2, .shape = 2},
+        {.blocks = {0, 0, 0, 0, 3, 0, 0, 0, 3, 3, 3, 0, 0, 0, 0, 0},
+         .marg_left = {4, 0, 0, 4},
+         .marg_right = {-1, 0, 2, -1},
+         .marg_bottom = {2, 2, 2, -1},
+         .rows = {0, 1, 7, 0},
+         .left = 0, .right = 2, .top = 1, .bottom = 2, .shape = 3}
+    },
+    // S
+    {
+        {.blocks = {0, 0, 0, 0, 0, 4, 0, 0, 0, 4, 4, 0, 0, 0, 4, 0},
+         .marg_left = {4, 1, 1, 2},
+         .marg_right = {-1, 1, 2, 2},
+         .marg_bottom = {-1, 2, 3, -1},
+         .rows = {0, 1, 3, 2},
+         .left = 1, .right = 2, .top = 1, .bottom = 3, .shape = 0},
+        {.blocks = {0, 0, 0, 0, 0, 0, 4, 4, 0, 4, 4, 0, 0, 0, 0, 0},
+         .marg_left = {4, 2, 1, 4},
+         .marg_right = {-1, 3, 2, -1},
+         .marg_bottom = {-1, 2, 2, 1},
+         .rows = {0, 6, 3, 0},
+         .left = 1, .right = 3, .top = 1, .bottom = 2, .shape = 1},
+        {.blocks = {0, 4, 0, 0, 0, 4, 4, 0, 0, 0, 4, 0, 0, 0, 0, 0},
+         .marg_left = {1, 1, 2, 4},
+         .marg_right = {1, 2, 2, -1},
+         .marg_bottom = {-1, 1, 2, -1},
+         .rows = {1, 3, 2, 0},
+         .left = 1, .right = 2, .top = 0, .bottom = 2, .shape = 0},
+        {.blocks = {0, 0, 0, 0, 0, 4, 4, 0, 4, 4, 0, 0, 0, 0, 0, 0},
+         .marg_left = {4, 1, 0, 4},
+         .marg_right = {-1, 2, 1, -1},
+         .marg_bottom = {2, 2, 1, -1},
+         .rows = {0, 6, 3, 0},
+         .left = 0, .right = 2, .top = 1, .bottom = 2, .shape = 1}
+    },
+    // Z
+    {
+        {.blocks = {0, 0, 0, 0, 0, 0, 4, 0, 0, 4, 4, 0, 0, 4, 0, 0},
+         .marg_left = {4, 2, 1, 1},
+         .marg_right = {-1, 2, 2, 1},
+         .marg_bottom = {-1, 3, 2, -1},
+         .rows = {0, 2, 3, 1},
+         .left = 1, .right = 2, .top = 1, .bottom = 3, .shape = 0},
+        {.blocks = {0, 0, 0, 0, 0, 4, 4, 0, 0, 0, 4, 4, 0, 0, 0, 0},
+         .marg_left = {4, 1, 2, 4},
+         .marg_right = {-1, 2, 3, -1},
+         .marg_bottom = {-1, 1, 2, 2},
+         .rows = {0, 3, 6, 0},
+         .left = 1, .right = 3, .top = 1, .bottom = 2, .shape = 1},
+        {.blocks = {0, 0, 4, 0, 0, 4, 4, 0, 0, 4, 0, 0, 0, 0, 0, 0},
+         .marg_left = {2, 1, 1, 4},
+         .marg_right = {2, 2, 1, -1},
+         .marg_bottom = {-1, 2, 1, -1},
+         .rows = {2, 3, 1, 0},
+         .left = 1, .right = 2, .top = 0, .bottom = 2, .shape = 0},
+        {.blocks = {0, 0, 0, 0, 4, 4, 0, 0, 0, 4, 4, 0, 0, 0, 0, 0},
+         .marg_left = {4, 0, 1, 4},
+         .marg_right = {-1, 1, 2, -1},
+         .marg_bottom = {1, 2, 2, -1},
+         .rows = {0, 3, 6, 0},
+         .left = 0, .right = 2, .top = 1, .bottom = 2, .shape = 1}
+    },
+    // T
+    {
+        {.blocks = {0, 0, 0, 0, 0, 5, 0, 0, 5, 5, 5, 0, 0, 0, 0, 0},
+         .marg_left = {4, 1, 0, 4},
+         .marg_right = {-1, 1, 2, -1},
+         .marg_bottom = {2, 2, 2, -1},
+         .rows = {0, 2, 7, 0},
+         .left = 0, .right = 2, .top = 1, .bottom = 2, .shape = 0},
+        {.blocks = {0, 0, 0, 0, 0, 0, 5, 0, 0, 5, 5, 0, 0, 0, 5, 0},
+         .marg_left = {4, 2, 1, 2},
+         .marg_right = {-1, 2, 2, 2},
+         .marg_bottom = {-1, 2, 3, -1},
+         .rows = {0, 2, 3, 2},
+         .left = 1, .right = 2, .top = 1, .bottom = 3, .shape = 1},
+        {.blocks = {0, 0, 0, 0, 0, 5, 5, 5, 0, 0, 5, 0, 0, 0, 0, 0},
+         .marg_left = {4, 1, 2, 4},
+         .marg_right = {-1, 3, 2, -1},
+         .marg_bottom = {-1, 1, 2, 1},
+         .rows = {0, 7, 2, 0},
+         .left = 1, .right = 3, .top = 1, .bottom = 2, .shape = 2},
+        {.blocks = {0, 5, 0, 0, 0, 5, 5, 0, 0, 5, 0, 0, 0, 0, 0, 0},
+         .marg_left = {1, 1, 1, 4},
+         .marg_right = {1, 2, 1, -1},
+         .marg_bottom = {-1, 2, 1, -1},
+         .rows = {1, 3, 1, 0},
+         .left = 1, .right = 2, .top = 0, .bottom = 2, .shape = 3}
+    }
+};
@@ -0,0 +1,24 @@
+#include "policy.h"
+
+tAction policyRandom(tState* ST, void* ctx)
+{
+    (void)ST;
+    switch (getRandomInt((tRng*)ctx, 4))
+    {
+    case 0:
+        return ACTION_LEFT;
+    case 1:
+        return ACTION_RIGHT;
+    case 2:
+        return ACTION_ROTATE;
+    default:
+        return ACTION_NONE;
+    }
+}
+
+tAction policyDrop(tState* ST, void* ctx)
+{
+    (void)ST;
+    (void)ctx;
+    return ACTION_DROP;
+}
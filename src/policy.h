@@ -0,0 +1,26 @@
+#ifndef POLICY_H
+#define POLICY_H
+
+// Simple policies for the headless games (see tPolicy)
+
+#include "tetris_core.h"
+
+/**
+ * @brief Random policy: random moves and rotations
+ *
+ * @param ST : State data structure
+ * @param ctx : Random generator (tRng)
+ * @return tAction : Chosen action
+ */
+tAction policyRandom(tState *ST, void *ctx);
+
+/**
+ * @brief Drop policy: drop every item right away
+ *
+ * @param ST : State data structure
+ * @param ctx : Not used
+ * @return tAction : Chosen action
+ */
+tAction policyDrop(tState *ST, void *ctx);
+
+#endif // POLICY_H
@@ -0,0 +1,100 @@
+#include "prof.h"
+#include <stdio.h>
+#include <string.h>
+
+static const char* PHASE_NAMES[PHASE_COUNT] = {"events", "logic",   "bot",     "glass",
+                                               "item",   "welcome", "present", "frame"};
+
+const char* getPhaseName(tPhase phase)
+{
+    return phase < PHASE_COUNT ? PHASE_NAMES[phase] : "?";
+}
+
+void initProfiler(tProfiler* P)
+{
+    memset(P, 0, sizeof(*P));
+}
+
+void addSample(tProfiler* P, tPhase phase, uint64_t ns)
+{
+    tHist* H = &P->hist[phase];
+    uint64_t b = ns / PROF_BUCKET_NS;
+    H->counts[b < PROF_BUCKETS ? b : PROF_BUCKETS - 1]++;
+    H->n++;
+    H->sum += ns;
+    H->max = ns > H->max ? ns : H->max;
+}
+
+uint64_t getPercentile(const tHist* H, double p)
+{
+    if (H->n == 0)
+    {
+        return 0;
+    }
+    // rank of the percentile duration (1-based)
+    uint64_t rank = (uint64_t)(p * (double)H->n);
+    rank = rank < 1 ? 1 : rank > H->n ? H->n : rank;
+    uint64_t seen = 0;
+    for (int b = 0; b < PROF_BUCKETS; b++)
+    {
+        seen += H->counts[b];
+        if (seen >= rank)
+        {
+            // the last bucket has no upper bound
+            uint64_t upper = (uint64_t)(b + 1) * PROF_BUCKET_NS;
+            return upper < H->max && b < PROF_BUCKETS - 1 ? upper : H->max;
+        }
+    }
+    return H->max;
+}
+
+bool saveProfile(const tProfiler* P, const char* path)
+{
+    FILE* f = fopen(path, "w");
+    if (!f)
+    {
+        return false;
+    }
+    size_t len = strlen(path);
+    bool json = len > 5 && strcmp(path + len - 5, ".json") == 0;
+
+    if (json)
+    {
+        fprintf(f, "{\"bucket_us\": %d, \"phases\": [", PROF_BUCKET_NS / 1000);
+    }
+    else
+    {
+        fprintf(f, "phase,count,mean_us,p50_us,p99_us,max_us\n");
+    }
+    for (int i = 0; i < PHASE_COUNT; i++)
+    {
+        const tHist* H = &P->hist[i];
+        double mean = H->n ? (double)H->sum / H->n / 1000.0 : 0.0;
+        double p50 = getPercentile(H, 0.5) / 1000.0, p99 = getPercentile(H, 0.99) / 1000.0, max = H->max / 1000.0;
+        if (!json)
+        {
+            fprintf(f, "%s,%llu,%.1f,%.1f,%.1f,%.1f\n", PHASE_NAMES[i], (unsigned long long)H->n, mean, p50, p99, max);
+            continue;
+        }
+        fprintf(f,
+                "%s\n  {\"phase\": \"%s\", \"count\": %llu, \"mean_us\": %.1f, \"p50_us\": %.1f, \"p99_us\": %.1f, "
+                "\"max_us\": %.1f, \"buckets\": [",
+                i ? "," : "", PHASE_NAMES[i], (unsigned long long)H->n, mean, p50, p99, max);
+        // only the used buckets: [lower bound in us, count]
+        bool first = true;
+        for (int b = 0; b < PROF_BUCKETS; b++)
+        {
+            if (H->counts[b])
+            {
+                fprintf(f, "%s[%d, %u]", first ? "" : ", ", b * (PROF_BUCKET_NS / 1000), H->counts[b]);
+                first = false;
+            }
+        }
+        fprintf(f, "]}");
+    }
+    if (json)
+    {
+        fprintf(f, "\n]}\n");
+    }
+    return fclose(f) == 0;
+}
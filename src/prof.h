@@ -0,0 +1,94 @@
+#ifndef PROF_H
+#define PROF_H
+
+// Frame profiler: durations of the main loop phases in fixed-bucket histograms
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define PROF_BUCKET_NS 10000 // Bucket width (10 us)
+#define PROF_BUCKETS 4096    // Number of buckets (the last one collects the longer durations)
+
+/**
+ * @brief Main loop phases
+ *
+ */
+typedef enum
+{
+    PHASE_EVENTS,  // Event polling
+    PHASE_LOGIC,   // Game timers, player actions and the replay
+    PHASE_BOT,     // Bot move
+    PHASE_GLASS,   // drawGlass() and drawHud()
+    PHASE_ITEM,    // drawItem()
+    PHASE_WELCOME, // drawWelcomeScreen()
+    PHASE_PRESENT, // SDL_RenderPresent()
+    PHASE_FRAME,   // Time between two presented frames
+    PHASE_COUNT
+} tPhase;
+
+/**
+ * @brief Histogram of durations
+ *
+ */
+typedef struct _thist
+{
+    uint32_t counts[PROF_BUCKETS]; // Number of durations in every bucket
+    uint64_t n;                    // Number of durations
+    uint64_t sum;                  // Sum of durations in ns
+    uint64_t max;                  // Longest duration in ns
+} tHist;
+
+/**
+ * @brief Profiler data structure
+ *
+ */
+typedef struct _tprofiler
+{
+    tHist hist[PHASE_COUNT]; // Histogram of every phase
+} tProfiler;
+
+/**
+ * @brief Name of the phase
+ *
+ * @param phase : Phase
+ * @return const char* : Name (lower case, no spaces)
+ */
+const char *getPhaseName(tPhase phase);
+
+/**
+ * @brief Clear all histograms
+ *
+ * @param P : Profiler
+ */
+void initProfiler(tProfiler *P);
+
+/**
+ * @brief Add the duration to the phase histogram
+ *
+ * @param P : Profiler
+ * @param phase : Phase
+ * @param ns : Duration in ns
+ */
+void addSample(tProfiler *P, tPhase phase, uint64_t ns);
+
+/**
+ * @brief Duration percentile (upper bound of its bucket, not over the maximum)
+ *
+ * @param H : Histogram
+ * @param p : Percentile in [0, 1]
+ * @return uint64_t : Duration in ns, 0 for the empty histogram
+ */
+uint64_t getPercentile(const tHist *H, double p);
+
+/**
+ * @brief Write the phase statistics: CSV (count, mean, p50, p99, max in us) or JSON with the buckets
+ * when the file name ends with .json
+ *
+ * @param P : Profiler
+ * @param path : File name
+ * @return true : Success
+ * @return false : The file can not be written
+ */
+bool saveProfile(const tProfiler *P, const char *path);
+
+#endif // PROF_H
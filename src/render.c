@@ -0,0 +1,268 @@
+#include "tetris.h"
+#include "policy.h"
+
+// Offscreen rendering: the game frames are drawn by drawFrame() through SDL's software renderer
+// into an RGBA surface, no window, display or GPU is needed (rendering benchmarks and golden images)
+
+/**
+ * @brief Offscreen rendering parameters
+ *
+ */
+typedef struct _trenderconfig
+{
+    int w, h;           // Frame size in px
+    uint64_t seed;      // Seed of the game
+    int items;          // Items played before the frame (0 - the welcome screen)
+    int frames;         // Frames drawn for the timing
+    bool text;          // Draw the text (fonts may render differently on other machines)
+    bool dirty;         // The glass changes every frame (the glass layer is redrawn)
+    const char *write;  // BMP file for the frame (NULL - not written)
+    const char *golden; // BMP file to compare the frame with (NULL - not compared)
+    tGlassSize glass;   // Glass size
+} tRenderConfig;
+
+/**
+ * @brief Make the game state of the frame: random moves till the item, then the next item falls
+ *
+ * @param ST : State data structure
+ * @param C : Parameters
+ */
+static void makeScene(tState *ST, const tRenderConfig *C)
+{
+    tRng moves;
+    memset(ST, 0, sizeof(*ST));
+    setGlassSize(ST, C->glass.w, C->glass.h);
+    ST->GAME_STATE = GAME_WELCOME;
+    ST->ITEM_ID = -1;
+    if (C->items == 0)
+    {
+        return;
+    }
+    initRandomizer(ST, C->seed, RANDOM_UNIFORM);
+    seedRandom(&moves, ~C->seed);
+    playGame(ST, policyRandom, &moves, C->items);
+    if (ST->GAME_STATE != GAME_FINISHED && spawnItem(ST, getNextItem(ST)))
+    {
+        // a few lines down from the top
+        for (int i = 0; i < 3 && !checkItemBottom(ST); i++)
+        {
+            ST->gy++;
+        }
+    }
+}
+
+/**
+ * @brief Count the pixels differing from the golden image (RGB only)
+ *
+ * @param frame : Drawn frame (SDL_PIXELFORMAT_RGBA32)
+ * @param path : Golden BMP file
+ * @return long : Number of different pixels, -1 if the file can not be read or has another size
+ */
+static long compareGolden(SDL_Surface *frame, const char *path)
+{
+    SDL_Surface *file = SDL_LoadBMP(path);
+    SDL_Surface *golden = file ? SDL_ConvertSurfaceFormat(file, SDL_PIXELFORMAT_RGBA32, 0) : NULL;
+    long diff = -1;
+    if (golden && golden->w == frame->w && golden->h == frame->h)
+    {
+        diff = 0;
+        for (int y = 0; y < frame->h; y++)
+        {
+            const uint8_t *a = (const uint8_t *)frame->pixels + y * frame->pitch;
+            const uint8_t *b = (const uint8_t *)golden->pixels + y * golden->pitch;
+            for (int x = 0; x < frame->w; x++)
+            {
+                diff += a[4 * x] != b[4 * x] || a[4 * x + 1] != b[4 * x + 1] || a[4 * x + 2] != b[4 * x + 2];
+            }
+        }
+    }
+    if (golden)
+    {
+        SDL_FreeSurface(golden);
+    }
+    if (file)
+    {
+        SDL_FreeSurface(file);
+    }
+    return diff;
+}
+
+static void usage(const char *prog)
+{
+    printf("Usage: %s [-w W] [-h H] [-glass WxH] [-seed S] [-items N] [-frames F] [-notext] [-dirty]"
+           " [-write FILE.bmp] [-golden FILE.bmp]\n",
+           prog);
+}
+
+/**
+ * @brief Offscreen renderer
+ *
+ * @param argc : Number of arguments passed to the program
+ * @param argv : Values of arguments passed to the program
+ * @return int : 0 - success (the frame matches the golden image), 1 - otherwise
+ */
+int main(int argc, char **argv)
+{
+    tRenderConfig C = {.w = 1200, .h = 800, .seed = 1, .items = 30, .frames = 1000, .text = true};
+    initGlassSize(&C.glass, GLASS_W, GLASS_H);
+    for (int i = 1; i < argc; i++)
+    {
+        bool has_value = i + 1 < argc;
+        if (strcmp(argv[i], "-w") == 0 && has_value)
+        {
+            C.w = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-h") == 0 && has_value)
+        {
+            C.h = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-glass") == 0 && has_value && parseGlassSize(&C.glass, argv[i + 1]))
+        {
+            i++;
+        }
+        else if (strcmp(argv[i], "-seed") == 0 && has_value)
+        {
+            C.seed = strtoull(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "-items") == 0 && has_value)
+        {
+            C.items = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-frames") == 0 && has_value)
+        {
+            C.frames = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-write") == 0 && has_value)
+        {
+            C.write = argv[++i];
+        }
+        else if (strcmp(argv[i], "-golden") == 0 && has_value)
+        {
+            C.golden = argv[++i];
+        }
+        else if (strcmp(argv[i], "-notext") == 0)
+        {
+            C.text = false;
+        }
+        else if (strcmp(argv[i], "-dirty") == 0)
+        {
+            C.dirty = true;
+        }
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (C.w < 1 || C.h < 1 || C.items < 0 || C.frames < 1)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    // no video subsystem: the software renderer draws straight into the surface memory
+    if (SDL_Init(0) != 0 || (C.text && TTF_Init() == -1))
+    {
+        printf("Error initializing SDL: %s\n", SDL_GetError());
+        return 1;
+    }
+    SDL_Surface *frame = SDL_CreateRGBSurfaceWithFormat(0, C.w, C.h, 32, SDL_PIXELFORMAT_RGBA32);
+    SDL_Renderer *rend = frame ? SDL_CreateSoftwareRenderer(frame) : NULL;
+    if (!rend)
+    {
+        printf("Error creating the software renderer: %s\n", SDL_GetError());
+        SDL_Quit();
+        return 1;
+    }
+
+    tView VW;
+    initView(&VW, C.w, C.h, &C.glass);
+    const int font_sizes[] = {TITLE_FONT_SIZE, SUBTITLE_FONT_SIZE, HUD_FONT_SIZE};
+    if (C.text && initTextCache(&VW.TEXT, rend, FONT_PATH, font_sizes, 3))
+    {
+        buildGlyphAtlas(&VW.TEXT, HUD_FONT_SIZE);
+    }
+    else if (C.text)
+    {
+        printf("Error opening font %s, the text is not drawn\n", FONT_PATH);
+    }
+
+    tState ST;
+    makeScene(&ST, &C);
+
+    // the same frame again and again: the first one renders the text and the glass layer
+    static tProfiler PROF;
+    initProfiler(&PROF);
+    uint64_t start = clock_ns();
+    for (int f = 0; f < C.frames; f++)
+    {
+        if (C.dirty)
+        {
+            ST.glass_version++;
+        }
+        drawFrame(rend, &VW, &ST, &PROF);
+        uint64_t t = clock_ns();
+        SDL_RenderPresent(rend);
+        endPhase(&PROF, PHASE_PRESENT, t);
+        addSample(&PROF, PHASE_FRAME, clock_ns() - start);
+        start = clock_ns();
+    }
+
+    printf("%dx%d, %s, %d frames\n", C.w, C.h, getGameState(ST.GAME_STATE), C.frames);
+    printf("phase       p50 us   p99 us   max us\n");
+    for (int i = 0; i < PHASE_COUNT; i++)
+    {
+        const tHist *H = &PROF.hist[i];
+        if (H->n > 0)
+        {
+            printf("%-10s %8.1f %8.1f %8.1f\n", getPhaseName((tPhase)i), getPercentile(H, 0.5) / 1e3,
+                   getPercentile(H, 0.99) / 1e3, H->max / 1e3);
+        }
+    }
+
+    int res = 0;
+    if (SDL_MUSTLOCK(frame))
+    {
+        SDL_LockSurface(frame);
+    }
+    if (C.write)
+    {
+        if (SDL_SaveBMP(frame, C.write) == 0)
+        {
+            printf("frame written: %s\n", C.write);
+        }
+        else
+        {
+            printf("Error writing %s: %s\n", C.write, SDL_GetError());
+            res = 1;
+        }
+    }
+    if (C.golden)
+    {
+        long diff = compareGolden(frame, C.golden);
+        if (diff < 0)
+        {
+            printf("Error reading the golden image %s (or it has another size)\n", C.golden);
+        }
+        else
+        {
+            printf("golden image %s: %ld different pixels\n", C.golden, diff);
+        }
+        res = diff != 0;
+    }
+    if (SDL_MUSTLOCK(frame))
+    {
+        SDL_UnlockSurface(frame);
+    }
+
+    freeTextCache(&VW.TEXT);
+    freeGlass(&VW);
+    SDL_DestroyRenderer(rend);
+    SDL_FreeSurface(frame);
+    if (C.text)
+    {
+        TTF_Quit();
+    }
+    SDL_Quit();
+    return res;
+}
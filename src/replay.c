@@ -0,0 +1,313 @@
+#include "replay.h"
+#include <stdlib.h>
+
+static const uint8_t REPLAY_MAGIC[4] = {'T', 'R', 'P', 'L'};
+
+/**
+ * @brief Make room for n more bytes
+ *
+ * @param R : Replay
+ * @param n : Number of bytes
+ * @return true : Success
+ * @return false : Out of memory
+ */
+static bool reserveBytes(tReplay* R, size_t n)
+{
+    if (R->size + n <= R->cap)
+    {
+        return true;
+    }
+    size_t cap = R->cap ? R->cap : 256;
+    while (cap < R->size + n)
+    {
+        cap *= 2;
+    }
+    uint8_t* data = realloc(R->data, cap);
+    if (!data)
+    {
+        return false;
+    }
+    R->data = data;
+    R->cap = cap;
+    return true;
+}
+
+static bool writeUint(tReplay* R, uint64_t v, int bytes)
+{
+    if (!reserveBytes(R, bytes))
+    {
+        return false;
+    }
+    for (int i = 0; i < bytes; i++)
+    {
+        R->data[R->size++] = (uint8_t)(v >> (8 * i));
+    }
+    return true;
+}
+
+static uint64_t readUint(const uint8_t* p, int bytes)
+{
+    uint64_t v = 0;
+    for (int i = 0; i < bytes; i++)
+    {
+        v |= (uint64_t)p[i] << (8 * i);
+    }
+    return v;
+}
+
+static bool writeVarint(tReplay* R, uint64_t v)
+{
+    if (!reserveBytes(R, 10))
+    {
+        return false;
+    }
+    for (; v >= 0x80; v >>= 7)
+    {
+        R->data[R->size++] = (uint8_t)(v | 0x80);
+    }
+    R->data[R->size++] = (uint8_t)v;
+    return true;
+}
+
+/**
+ * @brief Decode the varint
+ *
+ * @param data : Encoded replay
+ * @param size : Size of the replay
+ * @param pos : Position of the varint, moved after it
+ * @param v : Decoded value
+ * @return true : Success
+ * @return false : The data ends inside the varint
+ */
+static bool readVarint(const uint8_t* data, size_t size, size_t* pos, uint64_t* v)
+{
+    *v = 0;
+    for (int shift = 0; *pos < size && shift < 64; shift += 7)
+    {
+        uint8_t b = data[(*pos)++];
+        *v |= (uint64_t)(b & 0x7f) << shift;
+        if (!(b & 0x80))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+uint64_t hashGlass(const tState* ST)
+{
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (int i = 0; i < ST->size.h * ST->size.w; i++)
+    {
+        h = (h ^ ST->glass[i]) * 0x100000001b3ull;
+    }
+    return h;
+}
+
+bool startReplay(tReplay* R, tReplayHeader* H)
+{
+    memset(R, 0, sizeof(*R));
+    H->version = REPLAY_VERSION;
+    if (!reserveBytes(R, REPLAY_HEADER_SIZE))
+    {
+        return false;
+    }
+    memcpy(R->data, REPLAY_MAGIC, 4);
+    R->size = 4;
+    writeUint(R, H->version, 1);
+    writeUint(R, H->glass_w, 1);
+    writeUint(R, H->glass_h, 1);
+    writeUint(R, H->randomizer, 1);
+    writeUint(R, H->seed, 8);
+    writeUint(R, H->fall_ms, 2);
+    writeUint(R, H->fast_ms, 2);
+    writeUint(R, H->spawn_ms, 2);
+    return true;
+}
+
+bool recordAction(tReplay* R, uint32_t ms, tAction action)
+{
+    if (!R->data || R->finished || action == ACTION_NONE || ms < R->last)
+    {
+        return false;
+    }
+    // the action takes 3 bits, the time delta is usually under 2^4 or 2^11 ms: 1 or 2 bytes per record
+    bool ok = writeVarint(R, (uint64_t)(ms - R->last) << 3 | (uint64_t)action);
+    R->last = ms;
+    return ok;
+}
+
+bool finishReplay(tReplay* R, uint32_t ms, const tState* ST)
+{
+    if (!R->data || R->finished || ms < R->last)
+    {
+        return false;
+    }
+    bool ok = writeVarint(R, (uint64_t)(ms - R->last) << 3 | ACTION_NONE) && writeUint(R, (uint32_t)ST->items, 4) &&
+              writeUint(R, (uint32_t)ST->lines, 4) && writeUint(R, hashGlass(ST), 8);
+    R->last = ms;
+    R->finished = ok;
+    return ok;
+}
+
+void freeReplay(tReplay* R)
+{
+    free(R->data);
+    memset(R, 0, sizeof(*R));
+}
+
+bool saveReplay(const tReplay* R, const char* path)
+{
+    FILE* f = fopen(path, "wb");
+    if (!f)
+    {
+        return false;
+    }
+    bool ok = fwrite(R->data, 1, R->size, f) == R->size;
+    return fclose(f) == 0 && ok;
+}
+
+bool loadReplay(tReplay* R, const char* path)
+{
+    memset(R, 0, sizeof(*R));
+    FILE* f = fopen(path, "rb");
+    if (!f)
+    {
+        return false;
+    }
+    bool ok = true;
+    uint8_t buf[4096];
+    size_t n;
+    while (ok && (n = fread(buf, 1, sizeof(buf), f)) > 0)
+    {
+        ok = reserveBytes(R, n);
+        if (ok)
+        {
+            memcpy(R->data + R->size, buf, n);
+            R->size += n;
+        }
+    }
+    fclose(f);
+    if (!ok)
+    {
+        freeReplay(R);
+    }
+    R->finished = ok;
+    return ok;
+}
+
+bool readReplayHeader(const uint8_t* data, size_t size, tReplayHeader* H)
+{
+    if (size < REPLAY_HEADER_SIZE || memcmp(data, REPLAY_MAGIC, 4) != 0)
+    {
+        return false;
+    }
+    H->version = data[4];
+    H->glass_w = data[5];
+    H->glass_h = data[6];
+    H->randomizer = data[7];
+    H->seed = readUint(data + 8, 8);
+    H->fall_ms = (uint16_t)readUint(data + 16, 2);
+    H->fast_ms = (uint16_t)readUint(data + 18, 2);
+    H->spawn_ms = (uint16_t)readUint(data + 20, 2);
+    tGlassSize G;
+    return H->version == REPLAY_VERSION && initGlassSize(&G, H->glass_w, H->glass_h) &&
+           H->randomizer <= RANDOM_BAG && H->fall_ms > 0 && H->fast_ms > 0;
+}
+
+size_t getReplaySize(const uint8_t* data, size_t size)
+{
+    tReplayHeader H;
+    if (!readReplayHeader(data, size, &H))
+    {
+        return 0;
+    }
+    size_t pos = REPLAY_HEADER_SIZE;
+    uint64_t v;
+    while (readVarint(data, size, &pos, &v))
+    {
+        if ((v & 7) == ACTION_NONE)
+        {
+            return size - pos < REPLAY_FOOTER_SIZE ? 0 : pos + REPLAY_FOOTER_SIZE;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Run the game clock till the time, call the observer after every stopped item
+ *
+ * @param ST : State data structure
+ * @param C : Game clock
+ * @param now : Game time
+ * @param hook : Observer (NULL - the ticks are run at once)
+ * @param ctx : Observer data
+ */
+static void advanceWatched(tState* ST, tGameClock* C, uint32_t now, tReplayHook hook, void* ctx)
+{
+    if (!hook || ST->GAME_STATE == GAME_FINISHED)
+    {
+        advanceGame(ST, C, now);
+        return;
+    }
+    // tick by tick: the same steps as one advanceGame() call
+    for (uint32_t t = getNextTick(ST, C); t <= now; t = getNextTick(ST, C))
+    {
+        tGameState before = ST->GAME_STATE;
+        advanceGame(ST, C, t);
+        if (ST->GAME_STATE == GAME_FINISHED)
+        {
+            return;
+        }
+        if (before == ITEM_STOPPED && ST->GAME_STATE == ITEM_STARTED)
+        {
+            hook(ST, C->now, ctx);
+        }
+    }
+    C->now = now;
+}
+
+tReplayResult playReplay(const uint8_t* data, size_t size, tState* ST, tReplayHook hook, void* ctx)
+{
+    tReplayResult res = {0};
+    tReplayHeader H;
+    tGameClock C;
+    if (!readReplayHeader(data, size, &H))
+    {
+        return res;
+    }
+    setGlassSize(ST, H.glass_w, H.glass_h);
+    initRandomizer(ST, H.seed, (tRandomizer)H.randomizer);
+    initClock(&C, H.fall_ms, H.fast_ms, H.spawn_ms);
+    startTimedGame(ST, &C);
+
+    size_t pos = REPLAY_HEADER_SIZE;
+    uint64_t v;
+    while (readVarint(data, size, &pos, &v))
+    {
+        // the same steps as in the game loop: the timers run till the action time, then the action is applied
+        res.time += (uint32_t)(v >> 3);
+        advanceWatched(ST, &C, res.time, hook, ctx);
+        tAction action = (tAction)(v & 7);
+        if (action == ACTION_NONE)
+        {
+            if (size - pos < REPLAY_FOOTER_SIZE)
+            {
+                return res;
+            }
+            res.valid = true;
+            res.finished = ST->GAME_STATE == GAME_FINISHED;
+            res.verified = readUint(data + pos, 4) == (uint32_t)ST->items &&
+                           readUint(data + pos + 4, 4) == (uint32_t)ST->lines &&
+                           readUint(data + pos + 8, 8) == hashGlass(ST);
+            return res;
+        }
+        if (action > ACTION_HARD_DROP)
+        {
+            return res;
+        }
+        applyAction(ST, action);
+        res.actions++;
+    }
+    return res;
+}
@@ -0,0 +1,169 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+// Game replays: the seed and the timer settings, then the player actions with their game times
+//
+// File layout (little-endian):
+//   "TRPL", version (1 byte), glass width, glass height, randomizer (1 byte each),
+//   seed (8 bytes), fall, fast and spawn periods in ms (2 bytes each),
+//   records: varint((time - previous time) << 3 | action), ACTION_NONE ends the records,
+//   footer: items, lines (4 bytes each), hash of the final glass (8 bytes)
+// A replay knows its own size, so a pack of replays is just the files one after another.
+
+#include "tetris_core.h"
+
+#define REPLAY_VERSION 1
+#define REPLAY_HEADER_SIZE 22
+#define REPLAY_FOOTER_SIZE 16
+
+/**
+ * @brief Replay settings: everything needed to repeat the game besides the actions
+ *
+ */
+typedef struct _treplayheader
+{
+    uint8_t version;    // Format version
+    uint8_t glass_w;    // Glass width
+    uint8_t glass_h;    // Glass height
+    uint8_t randomizer; // Way to choose the next item (tRandomizer)
+    uint64_t seed;      // Seed of the item generator
+    uint16_t fall_ms;   // Period of the slow falling
+    uint16_t fast_ms;   // Period of the fast falling
+    uint16_t spawn_ms;  // Delay before the next item appears
+} tReplayHeader;
+
+/**
+ * @brief Replay being recorded (encoded file in memory)
+ *
+ */
+typedef struct _treplay
+{
+    uint8_t *data; // Encoded replay
+    size_t size;   // Used bytes
+    size_t cap;    // Allocated bytes
+    uint32_t last; // Game time of the last record
+    bool finished; // The footer is written
+} tReplay;
+
+/**
+ * @brief Result of the replay playback
+ *
+ */
+typedef struct _treplayresult
+{
+    bool valid;    // The replay is decoded
+    bool verified; // The final glass, items and lines match the recorded ones
+    bool finished; // The game is over (no room for a new item), otherwise the player left the game
+    uint32_t time; // Game time of the end
+    int actions;   // Number of played actions
+} tReplayResult;
+
+/**
+ * @brief Playback observer: called when the stopped item is in the glass and the full lines are removed
+ *
+ * @param ST : State data structure
+ * @param ms : Game time
+ * @param ctx : Observer data
+ */
+typedef void (*tReplayHook)(const tState *ST, uint32_t ms, void *ctx);
+
+/**
+ * @brief Start recording: write the header
+ *
+ * @param R : Replay
+ * @param H : Replay settings (the version is set here, the glass size is the one of the game)
+ * @return true : Success
+ * @return false : Out of memory
+ */
+bool startReplay(tReplay *R, tReplayHeader *H);
+
+/**
+ * @brief Record the player action
+ *
+ * @param R : Replay
+ * @param ms : Game time (tGameClock.now) when the action is applied, not less than the previous one
+ * @param action : Applied action
+ * @return true : Success
+ * @return false : Out of memory, the replay is not started or finished
+ */
+bool recordAction(tReplay *R, uint32_t ms, tAction action);
+
+/**
+ * @brief Finish recording: the end time and the final glass
+ *
+ * @param R : Replay
+ * @param ms : Game time of the end
+ * @param ST : Final state
+ * @return true : Success
+ * @return false : Out of memory
+ */
+bool finishReplay(tReplay *R, uint32_t ms, const tState *ST);
+
+/**
+ * @brief Release the replay buffer
+ *
+ * @param R : Replay
+ */
+void freeReplay(tReplay *R);
+
+/**
+ * @brief Write the replay to the file
+ *
+ * @param R : Replay
+ * @param path : File name
+ * @return true : Success
+ * @return false : The file can not be written
+ */
+bool saveReplay(const tReplay *R, const char *path);
+
+/**
+ * @brief Read the replay file
+ *
+ * @param R : Replay (the buffer is allocated)
+ * @param path : File name
+ * @return true : Success
+ * @return false : The file can not be read
+ */
+bool loadReplay(tReplay *R, const char *path);
+
+/**
+ * @brief Decode the replay header
+ *
+ * @param data : Encoded replay
+ * @param size : Size of the replay
+ * @param H : Decoded settings
+ * @return true : Valid header of the supported version and glass size
+ * @return false : Not a replay of this game
+ */
+bool readReplayHeader(const uint8_t *data, size_t size, tReplayHeader *H);
+
+/**
+ * @brief Get the size of the encoded replay (the records are scanned, nothing is played)
+ *
+ * @param data : Encoded replay, maybe followed by other replays
+ * @param size : Size of the data
+ * @return size_t : Size of the first replay, 0 if it is not a valid replay
+ */
+size_t getReplaySize(const uint8_t *data, size_t size);
+
+/**
+ * @brief Play the replay without timers and check the final glass
+ *
+ * @param data : Encoded replay (read only, may be a mapped file)
+ * @param size : Size of the replay
+ * @param ST : State data structure, the final state of the game (of the glass size of the replay)
+ * @param hook : Called after every stopped item (NULL - no observer)
+ * @param ctx : Observer data
+ * @return tReplayResult : Playback result
+ */
+tReplayResult playReplay(const uint8_t *data, size_t size, tState *ST, tReplayHook hook, void *ctx);
+
+/**
+ * @brief Hash of the glass blocks (to check the replay playback)
+ *
+ * @param ST : State data structure
+ * @return uint64_t : FNV-1a hash of the glass
+ */
+uint64_t hashGlass(const tState *ST);
+
+#endif // REPLAY_H
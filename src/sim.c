@@ -0,0 +1,288 @@
+#include "ai.h"
+#include "clock.h"
+#include "policy.h"
+#include <pthread.h>
+#include <stdlib.h>
+
+// Batch game simulator: plays N games on T threads, idle threads steal games from busy ones
+
+#define MAXTHREADS 256
+
+/**
+ * @brief Simulation parameters
+ *
+ */
+typedef struct _tsimconfig
+{
+    int games;              // Number of games to play
+    int threads;            // Number of worker threads
+    uint64_t seed;          // Game g is played with seed + g
+    tRandomizer randomizer; // Way to choose the next item
+    int max_items;          // Stop a game after this number of items (0 - no limit)
+    tPolicy policy;         // Policy of the games
+    int depth, beam;        // Search parameters of the bot
+    tGlassSize size;        // Glass size
+} tSimConfig;
+
+/**
+ * @brief Worker data: own range of games and statistics
+ *
+ */
+typedef struct _tworker
+{
+    pthread_mutex_t lock; // Protects next and end
+    int next, end;        // Games [next, end) are not played yet
+    int id;               // Worker number
+    pthread_t thread;     // Worker thread
+    long games;           // Played games
+    long items;           // Items put into the glass
+    long lines;           // Removed full lines
+    long steals;          // Successful steals from other workers
+    uint64_t busy_ns;     // Time spent playing games
+    tAI AI;               // Bot of the worker (the ai policy)
+} tWorker;
+
+static tSimConfig CFG;
+static tWorker WORKERS[MAXTHREADS];
+
+/**
+ * @brief Take the next game from own range
+ *
+ * @param W : Worker
+ * @return int : Game number, -1 if the range is empty
+ */
+static int takeGame(tWorker *W)
+{
+    int g = -1;
+    pthread_mutex_lock(&W->lock);
+    if (W->next < W->end)
+    {
+        g = W->next++;
+    }
+    pthread_mutex_unlock(&W->lock);
+    return g;
+}
+
+/**
+ * @brief Move the upper half of the games of another worker to own range
+ *
+ * @param W : Worker
+ * @return true : Some games are stolen
+ * @return false : All workers have no games left
+ */
+static bool stealGames(tWorker *W)
+{
+    for (int k = 1; k < CFG.threads; k++)
+    {
+        tWorker *V = &WORKERS[(W->id + k) % CFG.threads];
+        int from = 0, to = 0;
+        pthread_mutex_lock(&V->lock);
+        int left = V->end - V->next;
+        if (left > 0)
+        {
+            to = V->end;
+            from = V->end - (left + 1) / 2;
+            V->end = from;
+        }
+        pthread_mutex_unlock(&V->lock);
+        if (from < to)
+        {
+            pthread_mutex_lock(&W->lock);
+            W->next = from;
+            W->end = to;
+            pthread_mutex_unlock(&W->lock);
+            W->steals++;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void *worker(void *arg)
+{
+    tWorker *W = arg;
+    tState ST;
+    tRng moves;
+    void *ctx = CFG.policy == policyAI ? (void *)&W->AI : &moves;
+
+    setGlassSize(&ST, CFG.size.w, CFG.size.h);
+
+    for (;;)
+    {
+        int g = takeGame(W);
+        if (g < 0)
+        {
+            if (!stealGames(W))
+            {
+                break;
+            }
+            continue;
+        }
+        uint64_t start = clock_ns();
+        initRandomizer(&ST, CFG.seed + g, CFG.randomizer);
+        seedRandom(&moves, ~(CFG.seed + g));
+        playGame(&ST, CFG.policy, ctx, CFG.max_items);
+        W->busy_ns += clock_ns() - start;
+        W->games++;
+        W->items += ST.items;
+        W->lines += ST.lines;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Get the policy by its name
+ *
+ * @param name : random, drop or ai
+ * @return tPolicy : Policy, NULL if the name is unknown
+ */
+static tPolicy getPolicy(const char *name)
+{
+    if (strcmp(name, "random") == 0)
+    {
+        return policyRandom;
+    }
+    if (strcmp(name, "drop") == 0)
+    {
+        return policyDrop;
+    }
+    if (strcmp(name, "ai") == 0)
+    {
+        return policyAI;
+    }
+    return NULL;
+}
+
+static void usage(const char *prog)
+{
+    printf("Usage: %s [-games N] [-threads T] [-seed S] [-bag] [-max-items M] [-policy random|drop|ai]"
+           " [-depth D] [-beam B] [-glass WxH]\n",
+           prog);
+}
+
+/**
+ * @brief Batch simulator
+ *
+ * @param argc : Number of arguments passed to the program
+ * @param argv : Values of arguments passed to the program
+ * @return int
+ */
+int main(int argc, char **argv)
+{
+    CFG.games = 1000;
+    CFG.threads = 4;
+    CFG.seed = 1;
+    CFG.randomizer = RANDOM_UNIFORM;
+    CFG.max_items = 0;
+    CFG.policy = policyRandom;
+    CFG.depth = 3;
+    CFG.beam = 32;
+    initGlassSize(&CFG.size, GLASS_W, GLASS_H);
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool has_value = i + 1 < argc;
+        if (strcmp(argv[i], "-games") == 0 && has_value)
+        {
+            CFG.games = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-threads") == 0 && has_value)
+        {
+            CFG.threads = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-seed") == 0 && has_value)
+        {
+            CFG.seed = strtoull(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "-max-items") == 0 && has_value)
+        {
+            CFG.max_items = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-policy") == 0 && has_value)
+        {
+            CFG.policy = getPolicy(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-depth") == 0 && has_value)
+        {
+            CFG.depth = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-beam") == 0 && has_value)
+        {
+            CFG.beam = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-glass") == 0 && has_value && parseGlassSize(&CFG.size, argv[i + 1]))
+        {
+            i++;
+        }
+        else if (strcmp(argv[i], "-bag") == 0)
+        {
+            CFG.randomizer = RANDOM_BAG;
+        }
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (!CFG.policy || CFG.threads < 1 || CFG.threads > MAXTHREADS || CFG.games < 0 || CFG.depth < 1 ||
+        CFG.depth > AI_MAXDEPTH || CFG.beam < 1 || CFG.beam > AI_MAXBEAM)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    // every worker has its own bot buffers and transposition table, all of them are allocated before the run
+    for (int t = 0; CFG.policy == policyAI && t < CFG.threads; t++)
+    {
+        if (!initAI(&WORKERS[t].AI, &CFG.size, CFG.depth, CFG.beam, 16))
+        {
+            printf("Out of memory for the bot of thread %d (depth %d, beam %d)\n", t, CFG.depth, CFG.beam);
+            for (int k = 0; k < t; k++)
+            {
+                freeAI(&WORKERS[k].AI);
+            }
+            return 1;
+        }
+    }
+
+    // initial split: equal ranges of games, the rest is balanced by stealing
+    for (int t = 0; t < CFG.threads; t++)
+    {
+        tWorker *W = &WORKERS[t];
+        pthread_mutex_init(&W->lock, NULL);
+        W->id = t;
+        W->next = (int)((long)CFG.games * t / CFG.threads);
+        W->end = (int)((long)CFG.games * (t + 1) / CFG.threads);
+    }
+
+    uint64_t start = clock_ns();
+    for (int t = 0; t < CFG.threads; t++)
+    {
+        pthread_create(&WORKERS[t].thread, NULL, worker, &WORKERS[t]);
+    }
+    for (int t = 0; t < CFG.threads; t++)
+    {
+        pthread_join(WORKERS[t].thread, NULL);
+    }
+    double wall = (clock_ns() - start) / 1e9;
+
+    long games = 0, items = 0, lines = 0;
+    for (int t = 0; t < CFG.threads; t++)
+    {
+        tWorker *W = &WORKERS[t];
+        printf("thread %3d: %8ld games %10ld items %4ld steals  %5.1f%% busy\n", t, W->games, W->items, W->steals,
+               wall > 0 ? 100.0 * W->busy_ns / 1e9 / wall : 0.0);
+        games += W->games;
+        items += W->items;
+        lines += W->lines;
+        pthread_mutex_destroy(&W->lock);
+        if (CFG.policy == policyAI)
+        {
+            freeAI(&W->AI);
+        }
+    }
+    printf("%ld games, %ld items, %ld lines in %.3f s\n", games, items, lines, wall);
+    printf("%.1f games/s, %.1f items/s, %.2f lines/game\n", games / wall, items / wall,
+           games > 0 ? (double)lines / games : 0.0);
+    return 0;
+}
@@ -1,434 +1,510 @@
 #include "tetris.h"
 
+// ticks later than this are dropped (the program was paused, the window was dragged)
+#define TIMER_MAX_LAG_NS 1000000000ull
+
 void timer_start(tTimer* t)
 {
-    t->last = GetTickCount();
+    t->next = clock_ns() + (uint64_t)t->ms * 1000000;
 }
 
-DWORD timer_check(tTimer* t)
+uint64_t timer_check(tTimer* t)
 {
-    return GetTickCount() - t->last;
+    uint64_t last = t->next - (uint64_t)t->ms * 1000000;
+    return (clock_ns() - last) / 1000000;
 }
 
 bool is_timer_tick(tTimer* t)
 {
-    return (GetTickCount() - t->last) >= t->ms;
+    uint64_t now = clock_ns();
+    if (now < t->next)
+    {
+        return false;
+    }
+    if (now - t->next > TIMER_MAX_LAG_NS)
+    {
+        timer_sync(t);
+        return true;
+    }
+    t->next += (uint64_t)t->ms * 1000000;
+    return true;
 }
 
-const char* getGameState(tGameState state)
+void timer_sync(tTimer* t)
 {
-    switch (state)
+    uint64_t now = clock_ns();
+    uint64_t period = (uint64_t)t->ms * 1000000;
+    if (now >= t->next)
     {
-    case GAME_WELCOME:
-        return "GAME_WELCOME";
-    case GAME_STARTED:
-        return "GAME_STARTED";
-    case ITEM_STARTED:
-        return "ITEM_STARTED";
-    case ITEM_FALLING:
-        return "ITEM_FALLING";
-    case ITEM_FALLING_FAST:
-        return "ITEM_FALLING_FAST";
-    case ITEM_STOPPED:
-        return "ITEM_STOPPED";
-    case GAME_FINISHED:
-        return "GAME_FINISHED";
+        t->next += ((now - t->next) / period + 1) * period;
     }
-    return "invalid status";
 }
 
-int8_t min4(int8_t a, int8_t b, int8_t c, int8_t d)
+/**
+ * @brief Whole ms till the deadline, rounded up: the sleep never ends before the deadline,
+ * so the loop does not wake up just to sleep again
+ *
+ * @param now : Current time in ns of clock_ns()
+ * @param deadline : Time in ns of clock_ns(), later than now
+ * @return Uint32 : ms to sleep
+ */
+static Uint32 getSleepMs(uint64_t now, uint64_t deadline)
 {
-    int8_t min = a;
+    return (Uint32)((deadline - now + 999999) / 1000000);
+}
 
-    if (b < min)
-    {
-        min = b;
-    }
-    if (c < min)
-    {
-        min = c;
-    }
-    if (d < min)
+void timer_sleep_until(uint64_t deadline)
+{
+    // the timer resolution is 1 ms (SDL_HINT_TIMER_RESOLUTION set in main()), no spinning for the last ms
+    uint64_t now = clock_ns();
+    if (now < deadline)
     {
-        min = d;
+        SDL_Delay(getSleepMs(now, deadline));
     }
-
-    return min;
 }
 
-int8_t max4(int8_t a, int8_t b, int8_t c, int8_t d)
+bool timer_wait_event_until(uint64_t deadline)
 {
-    int8_t max = a;
-
-    if (b > max)
-    {
-        max = b;
-    }
-    if (c > max)
+    // the event stays in the queue for SDL_PollEvent()
+    uint64_t now = clock_ns();
+    if (now >= deadline)
     {
-        max = c;
+        return false;
     }
-    if (d > max)
-    {
-        max = d;
-    }
-
-    return max;
+    return SDL_WaitEventTimeout(NULL, (int)getSleepMs(now, deadline)) != 0;
 }
 
-void updState(tState* ST)
+uint64_t getEventTime(Uint32 timestamp, uint64_t now)
 {
-    ST->gx = (ST->x - ST->glass_x) / ST->block_size;
-    ST->gy = (ST->y - ST->glass_y) / ST->block_size;
+    // the age of the event in SDL ticks (ms), an event from the future is taken as a current one
+    Uint32 age = SDL_GetTicks() - timestamp;
+    uint64_t age_ns = age < 0x80000000u ? (uint64_t)age * 1000000 : 0;
+    return age_ns < now ? now - age_ns : 0;
 }
 
-void getBottomMargins(tState* ST)
+bool pushInput(tInputQueue* Q, tAction action)
 {
-    for (int i = 0; i < ITEMBLOCKS; i++)
+    if (Q->count == INPUT_QUEUE_SIZE)
     {
-        for (ST->marg_bottom[i] = ITEMBLOCKS - 1; ST->marg_bottom[i] >= 0; ST->marg_bottom[i]--)
-        {
-            if (ST->items[ST->ITEM_ID][ST->marg_bottom[i] * ITEMBLOCKS + i] > 0)
-            {
-                break;
-            }
-        }
+        return false;
     }
+    Q->actions[(Q->head + Q->count) % INPUT_QUEUE_SIZE] = action;
+    Q->count++;
+    return true;
 }
 
-void getLeftMargins(tState* ST)
+bool popInput(tInputQueue* Q, tAction* action)
 {
-    for (int i = 0; i < ITEMBLOCKS; i++)
+    if (Q->count == 0)
     {
-        for (ST->marg_left[i] = 0; ST->marg_left[i] < ITEMBLOCKS; ST->marg_left[i]++)
-        {
-            if (ST->items[ST->ITEM_ID][i * ITEMBLOCKS + ST->marg_left[i]] > 0)
-            {
-                break;
-            }
-        }
+        return false;
     }
+    *action = Q->actions[Q->head];
+    Q->head = (Q->head + 1) % INPUT_QUEUE_SIZE;
+    Q->count--;
+    return true;
 }
 
-void getRightMargins(tState* ST)
+void clearInput(tInputQueue* Q)
 {
-    for (int i = 0; i < ITEMBLOCKS; i++)
-    {
-        for (ST->marg_right[i] = ITEMBLOCKS - 1; ST->marg_right[i] >= 0; ST->marg_right[i]--)
-        {
-            if (ST->items[ST->ITEM_ID][i * ITEMBLOCKS + ST->marg_right[i]] > 0)
-            {
-                break;
-            }
-        }
-    }
+    Q->head = 0;
+    Q->count = 0;
 }
 
-bool checkItemLeft(tState* ST)
+void pushShiftRepeats(tInputQueue* Q, tAutoShift* AS, uint64_t t, int max)
 {
-    for (int i = 0; i < ITEMBLOCKS; i++)
+    for (int n = takeShiftRepeats(AS, t, max); n > 0; n--)
     {
-        if (ST->marg_left[i] >= 0)
+        if (!pushInput(Q, AS->held))
         {
-            if (ST->gx + ST->marg_left[i] <= 0 || ST->glass[ST->gy + i + 0][ST->gx + ST->marg_left[i] - 1] > 0)
-            {
-                return true;
-            }
+            break;
         }
     }
-    return false;
 }
 
-bool checkItemRight(tState* ST)
+bool parse_opt_arg_uint(int argc, char** argv, int* ind, int* res)
 {
-    for (int i = 0; i < ITEMBLOCKS; i++)
+    if (*ind + 1 >= argc)
     {
-        if (ST->marg_right[i] >= 0)
-        {
-            if (ST->gx + ST->marg_right[i] >= GLASS_W - 1 ||
-                ST->glass[ST->gy + i + 0][ST->gx + ST->marg_right[i] + 1] > 0)
-            {
-                return true;
-            }
-        }
+        return false;
     }
-    return false;
-}
-
-bool checkItemBottom(tState* ST)
-{
-    for (int i = 0; i < ITEMBLOCKS; i++)
+    const char* arg = argv[*ind + 1];
+    for (const char* c = arg; *c; c++)
     {
-        if (ST->marg_bottom[i] >= 0)
+        if (!isdigit((unsigned char)*c))
         {
-            if (ST->gy + ST->marg_bottom[i] + 2 > GLASS_H || ST->glass[ST->gy + ST->marg_bottom[i] + 1][ST->gx + i] > 0)
-            {
-                return true;
-            }
+            return false;
         }
     }
-    return false;
+    if (*arg == 0)
+    {
+        return false;
+    }
+    *res = atoi(arg);
+    (*ind)++;
+    return true;
 }
 
-void rotateItem(tState* ST)
+bool parse_opt_arg_str(int argc, char** argv, int* ind, char* res, int len)
 {
-    int8_t* mat = ST->items[ST->ITEM_ID];
-    for (int8_t i = 0; i < ITEMBLOCKS / 2; i++)
+    if (*ind + 1 >= argc || len <= 0)
     {
-        for (int8_t j = i; j < ITEMBLOCKS - i - 1; j++)
-        {
-            // Calculate the indices in the one-dimensional array
-            int8_t index1 = i * ITEMBLOCKS + j;
-            int8_t index2 = j * ITEMBLOCKS + (ITEMBLOCKS - 1 - i);
-            int8_t index3 = (ITEMBLOCKS - 1 - i) * ITEMBLOCKS + (ITEMBLOCKS - 1 - j);
-            int8_t index4 = (ITEMBLOCKS - 1 - j) * ITEMBLOCKS + i;
-
-            // Save the current element in a temporary variable
-            int8_t temp = mat[index1];
-
-            // Move elements from right column to top row
-            mat[index1] = mat[index2];
-
-            // Move elements from bottom row to right column
-            mat[index2] = mat[index3];
-
-            // Move elements from left column to bottom row
-            mat[index3] = mat[index4];
-
-            // Move elements from top row to left column
-            mat[index4] = temp;
-        }
+        return false;
     }
-    getLeftMargins(ST);
-    getRightMargins(ST);
-    getBottomMargins(ST);
+    strncpy(res, argv[*ind + 1], len - 1);
+    res[len - 1] = 0;
+    (*ind)++;
+    return true;
 }
 
-void printItem(tState* ST)
+void parse_args(int argc, char** argv, tConfig* conf, SDL_DisplayMode* DM)
 {
-    int8_t* mat = ST->items[ST->ITEM_ID];
-    for (int8_t i = 0; i < ITEMBLOCKS; i++)
+    for (int i = 1; i < argc; i++)
     {
-        for (int8_t j = 0; j < ITEMBLOCKS; j++)
+        bool ok = true;
+        if (strcmp(argv[i], "-w") == 0)
+        {
+            ok = parse_opt_arg_uint(argc, argv, &i, &conf->w);
+        }
+        else if (strcmp(argv[i], "-h") == 0)
+        {
+            ok = parse_opt_arg_uint(argc, argv, &i, &conf->h);
+        }
+        else if (strcmp(argv[i], "-ai") == 0)
+        {
+            conf->autoplay = true;
+        }
+        else if (strcmp(argv[i], "-depth") == 0)
+        {
+            ok = parse_opt_arg_uint(argc, argv, &i, &conf->depth);
+        }
+        else if (strcmp(argv[i], "-beam") == 0)
+        {
+            ok = parse_opt_arg_uint(argc, argv, &i, &conf->beam);
+        }
+        else if (strcmp(argv[i], "-record") == 0)
+        {
+            ok = parse_opt_arg_str(argc, argv, &i, conf->record, sizeof(conf->record));
+        }
+        else if (strcmp(argv[i], "-profile") == 0)
         {
-            printf("%d ", mat[i * ITEMBLOCKS + j]);
+            ok = parse_opt_arg_str(argc, argv, &i, conf->profile, sizeof(conf->profile));
+        }
+        else if (strcmp(argv[i], "-overlay") == 0)
+        {
+            conf->overlay = true;
+        }
+        else if (strcmp(argv[i], "-glass") == 0)
+        {
+            ok = i + 1 < argc && parseGlassSize(&conf->glass, argv[i + 1]);
+            i += ok;
+        }
+        else if (strcmp(argv[i], "-das") == 0)
+        {
+            ok = parse_opt_arg_uint(argc, argv, &i, &conf->das_ms);
+        }
+        else if (strcmp(argv[i], "-arr") == 0)
+        {
+            ok = parse_opt_arg_uint(argc, argv, &i, &conf->arr_ms);
+        }
+        else
+        {
+            ok = false;
+        }
+        if (!ok)
+        {
+            LOG_WARN("Unknown argument or value: %s", argv[i]);
+            LOG_WARN("Usage: %s [-w W] [-h H] [-ai] [-depth D] [-beam B] [-record FILE] [-profile FILE] [-overlay]"
+                     " [-glass WxH] [-das MS] [-arr MS]",
+                     argv[0]);
         }
-        printf("\n");
     }
+    conf->x = (DM->w - conf->w) / 2;
+    conf->y = (DM->h - conf->h) / 2;
 }
 
-void copyBlocksToGlass(tState* ST)
+void initView(tView* VW, int w, int h, const tGlassSize* G)
 {
-    // copy stopped item blocks to glass
-    for (int i = 0; i < ITEMBLOCKS; i++)
+    static const uint8_t COLORS[MAXCOLORS][3] = {{0, 0, 0},      // transparent
+                                                 {228, 26, 28},  // red
+                                                 {255, 255, 51}, // yellow
+                                                 {255, 127, 0},  // orange
+                                                 {77, 175, 74},  // green
+                                                 {152, 78, 163}, // violet
+                                                 {80, 80, 80}};  // gray
+    memset(VW, 0, sizeof(*VW));
+    memcpy(VW->colors, COLORS, sizeof(COLORS));
+    VW->fps = 60;
+    VW->TIMER_FPS.ms = 1000 / VW->fps;
+    // 25 px blocks, smaller ones for a tall or wide glass (half of the window is left for the text)
+    VW->block_size = 25;
+    if (VW->block_size * G->h > h - 100)
     {
-        for (int j = 0; j < ITEMBLOCKS; j++)
-        {
-            if (ST->items[ST->ITEM_ID][j * ITEMBLOCKS + i] > 0)
-            {
-                ST->glass[ST->gy + j][ST->gx + i] = ST->items[ST->ITEM_ID][j * ITEMBLOCKS + i];
-            }
-        }
+        VW->block_size = (h - 100) / G->h;
+    }
+    if (VW->block_size * G->w > w / 2)
+    {
+        VW->block_size = w / 2 / G->w;
+    }
+    if (VW->block_size < 4)
+    {
+        VW->block_size = 4;
     }
+    VW->glass_w = G->w * VW->block_size;
+    VW->glass_h = G->h * VW->block_size;
+    VW->glass_x = (w - VW->glass_w) / 2;
+    VW->glass_y = (h - VW->glass_h) / 2;
 }
 
-void printGlass(tState* ST)
+/**
+ * @brief Add the block to the batch (the blocks of the color are drawn when the batch is full)
+ *
+ * @param rend : Renderer data structure
+ * @param VW : View data structure
+ * @param e : Block color
+ * @param x, y : Left top corner of the block in px
+ */
+static void addBlock(SDL_Renderer* rend, tView* VW, int e, int x, int y)
 {
-    for (int i = 0; i < GLASS_H; i++)
+    tBlockBatch* B = &VW->BATCH;
+    if (e <= 0 || e >= MAXCOLORS)
     {
-        for (int j = 0; j < GLASS_W; j++)
-        {
-            printf("%d ", ST->glass[i][j]);
-        }
-        printf("\n");
+        return;
+    }
+    if (B->n[e] == BATCH_BLOCKS)
+    {
+        SDL_SetRenderDrawColor(rend, VW->colors[e][0], VW->colors[e][1], VW->colors[e][2], 255);
+        SDL_RenderFillRects(rend, B->rects[e], B->n[e]);
+        B->n[e] = 0;
     }
-    printf("\n");
+    SDL_Rect* rect = &B->rects[e][B->n[e]++];
+    rect->x = x;
+    rect->y = y;
+    rect->w = VW->block_size;
+    rect->h = VW->block_size;
 }
 
-void removeFullLine(tState* ST, int line)
+/**
+ * @brief Draw all blocks of the batch: one call per color, then empty the batch
+ *
+ * @param rend : Renderer data structure
+ * @param VW : View data structure
+ */
+static void flushBlocks(SDL_Renderer* rend, tView* VW)
 {
-    int fullCells;
-    do
+    tBlockBatch* B = &VW->BATCH;
+    for (int e = 1; e < MAXCOLORS; e++)
     {
-        fullCells = 0;
-        for (int j = 0; j < GLASS_W; j++)
+        if (B->n[e] > 0)
         {
-            ST->glass[line][j] = ST->glass[line - 1][j];
-            fullCells += (ST->glass[line][j] != 0);
+            SDL_SetRenderDrawColor(rend, VW->colors[e][0], VW->colors[e][1], VW->colors[e][2], 255);
+            SDL_RenderFillRects(rend, B->rects[e], B->n[e]);
+            B->n[e] = 0;
         }
-        --line;
-    } while (fullCells != 0 && line > 0);
+    }
 }
 
-bool checkRemoveFullLine(tState* ST)
+/**
+ * @brief Draw the ghost: outline of the falling item at its landing line
+ *
+ * @param rend : Renderer data structure
+ * @param VW : View data structure
+ * @param ST : State data structure
+ */
+static void drawGhost(SDL_Renderer* rend, tView* VW, tState* ST)
 {
-    int emptyCells;
-    for (int i = GLASS_H - 1; i >= 0; i--)
+    const tPiece* P = getItem(ST);
+    int gy = getLandingRow(ST, P, ST->gx, ST->gy);
+    if (gy == ST->gy)
     {
-        emptyCells = 0;
-        for (int j = 0; j < GLASS_W; j++)
-        {
-            emptyCells += (ST->glass[i][j] == 0);
-        }
-        if (emptyCells == 0)
+        return;
+    }
+    SDL_Rect rects[ITEMBLOCKS * ITEMBLOCKS];
+    int n = 0, e = 0;
+    for (int i = 0; i < ITEMBLOCKS; i++)
+    {
+        for (int j = 0; j < ITEMBLOCKS; j++)
         {
-            printf("full line: %d\n", i);
-
-            // remove full line found
-            removeFullLine(ST, i);
-
-            return true;
+            if (P->blocks[i * ITEMBLOCKS + j] > 0)
+            {
+                e = P->blocks[i * ITEMBLOCKS + j];
+                rects[n].x = VW->glass_x + (ST->gx + j) * VW->block_size;
+                rects[n].y = VW->glass_y + (gy + i) * VW->block_size;
+                rects[n].w = VW->block_size;
+                rects[n].h = VW->block_size;
+                n++;
+            }
         }
     }
-    return false;
+    SDL_SetRenderDrawColor(rend, VW->colors[e][0], VW->colors[e][1], VW->colors[e][2], 255);
+    SDL_RenderDrawRects(rend, rects, n);
 }
 
-void drawItem(SDL_Renderer* rend, int x, int y, tState* ST)
+void drawItem(SDL_Renderer* rend, tView* VW, tState* ST)
 {
     if (ST->GAME_STATE != ITEM_FALLING && ST->GAME_STATE != ITEM_FALLING_FAST)
     {
         return;
     }
-    SDL_Rect rect = { x, y, ST->block_size, ST->block_size };
-    int e;
+    drawGhost(rend, VW, ST);
+    int x = VW->glass_x + ST->gx * VW->block_size;
+    int y = VW->glass_y + ST->gy * VW->block_size;
+    const int8_t* blocks = getItem(ST)->blocks;
     for (int8_t i = 0; i < ITEMBLOCKS; i++)
     {
         for (int8_t j = 0; j < ITEMBLOCKS; j++)
         {
-            e = ST->items[ST->ITEM_ID][i * ITEMBLOCKS + j];
-            if (e > 0)
-            {
-                rect.y = y + i * ST->block_size;
-                rect.x = x + j * ST->block_size;
-                SDL_SetRenderDrawColor(rend, ST->colors[e][0], ST->colors[e][1], ST->colors[e][2], 255);
-                SDL_RenderFillRect(rend, &rect);
-            }
+            addBlock(rend, VW, blocks[i * ITEMBLOCKS + j], x + j * VW->block_size, y + i * VW->block_size);
         }
     }
+    flushBlocks(rend, VW);
 }
 
-void drawGlass(SDL_Renderer* rend, tState* ST)
+/**
+ * @brief Draw the glass background and the stopped blocks
+ *
+ * @param rend : Renderer data structure
+ * @param VW : View data structure
+ * @param ST : State data structure
+ * @param x, y : Left top corner of the glass in px
+ */
+static void drawGlassBlocks(SDL_Renderer* rend, tView* VW, tState* ST, int x, int y)
 {
-    SDL_Rect rect = { ST->glass_x, ST->glass_y, ST->glass_w, ST->glass_h };
+    SDL_Rect rect = { x, y, VW->glass_w, VW->glass_h };
     SDL_SetRenderDrawColor(rend, 0, 0, 0, 255);
     SDL_RenderFillRect(rend, &rect);
 
-    for (int i = 0; i < GLASS_H; i++)
+    // the bitboard skips the empty lines and cells
+    for (int i = ST->size.h - 1; i >= 0 && ST->rows[i] != 0; i--)
     {
-        for (int j = 0; j < GLASS_W; j++)
+        for (uint64_t bits = ST->rows[i]; bits != 0; bits &= bits - 1)
         {
-            int e = ST->glass[i][j];
-            if (e > 0)
-            {
-                rect.w = ST->block_size;
-                rect.h = ST->block_size;
-                rect.y = ST->glass_y + i * ST->block_size;
-                rect.x = ST->glass_x + j * ST->block_size;
-                SDL_SetRenderDrawColor(rend, ST->colors[e][0], ST->colors[e][1], ST->colors[e][2], 255);
-                SDL_RenderFillRect(rend, &rect);
-            }
+            int j = lowestBit(bits);
+            addBlock(rend, VW, GLASS_LINE(ST, i)[j], x + j * VW->block_size, y + i * VW->block_size);
         }
     }
+    flushBlocks(rend, VW);
 }
 
-void clearGlass(tState* ST)
+void drawGlass(SDL_Renderer* rend, tView* VW, tState* ST)
 {
-    for (int i = 0; i < GLASS_H; i++)
+    if (!VW->GLASS_LAYER)
     {
-        for (int j = 0; j < GLASS_W; j++)
+        VW->GLASS_LAYER = SDL_CreateTexture(rend, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, VW->glass_w,
+                                            VW->glass_h);
+        VW->glass_valid = false;
+        if (!VW->GLASS_LAYER)
         {
-            ST->glass[i][j] = 0;
+            // no render targets: draw the blocks every frame
+            drawGlassBlocks(rend, VW, ST, VW->glass_x, VW->glass_y);
+            return;
         }
     }
+    if (!VW->glass_valid || VW->glass_version != ST->glass_version)
+    {
+        SDL_SetRenderTarget(rend, VW->GLASS_LAYER);
+        drawGlassBlocks(rend, VW, ST, 0, 0);
+        SDL_SetRenderTarget(rend, NULL);
+        VW->glass_version = ST->glass_version;
+        VW->glass_valid = true;
+    }
+    SDL_Rect rect = { VW->glass_x, VW->glass_y, VW->glass_w, VW->glass_h };
+    SDL_RenderCopy(rend, VW->GLASS_LAYER, NULL, &rect);
 }
 
-void fallStep(tState* ST)
+void invalidateGlass(tView* VW)
 {
-    if (checkItemBottom(ST))
-    {
-        copyBlocksToGlass(ST);
-        ST->GAME_STATE = ITEM_STOPPED;
-    }
-    else
+    VW->glass_valid = false;
+}
+
+void freeGlass(tView* VW)
+{
+    if (VW->GLASS_LAYER)
     {
-        ST->y += ST->block_size;
-        updState(ST);
+        SDL_DestroyTexture(VW->GLASS_LAYER);
+        VW->GLASS_LAYER = NULL;
     }
+    VW->glass_valid = false;
+}
+
+void drawWelcomeScreen(SDL_Renderer* rend, tView* VW)
+{
+    (void)rend;
+    // the strings are rendered on the first frame only, then the cached textures are copied
+    int cx = VW->glass_x + VW->glass_w / 2;
+    drawTextCentered(&VW->TEXT, "TETRIS", TITLE_FONT_SIZE, cx, 250);
+    drawTextCentered(&VW->TEXT, "Press SPACE to start", SUBTITLE_FONT_SIZE, cx, 400);
 }
 
-void drawWelcomeScreen(SDL_Renderer* rend, tState* ST)
+void drawHud(SDL_Renderer* rend, tView* VW, tState* ST)
 {
-    // Try multiple possible font paths
-    const char* font_paths[] = {
-        FONT_PATH,
-        "src/" FONT_PATH,
-        "../src/" FONT_PATH,
-        NULL
-    };
-    
-    TTF_Font* title_font = NULL;
-    TTF_Font* subtitle_font = NULL;
-    
-    // Try to load font from different possible locations
-    for (int i = 0; font_paths[i] != NULL; i++)
+    (void)rend;
+    char text[32];
+    int x = VW->glass_x - 8 * HUD_FONT_SIZE;
+    snprintf(text, sizeof(text), "LINES %d", ST->lines);
+    drawAtlasText(&VW->TEXT, text, x, VW->glass_y);
+    snprintf(text, sizeof(text), "ITEMS %d", ST->items);
+    drawAtlasText(&VW->TEXT, text, x, VW->glass_y + 2 * HUD_FONT_SIZE);
+}
+
+void drawFrame(SDL_Renderer* rend, tView* VW, tState* ST, tProfiler* P)
+{
+    uint64_t t = clock_ns();
+
+    /* Clear screen */
+    SDL_SetRenderDrawColor(rend, VW->colors[6][0], VW->colors[6][1], VW->colors[6][2], 255);
+    SDL_RenderFillRect(rend, NULL);
+
+    /* Draw glass */
+    drawGlass(rend, VW, ST);
+    if (ST->GAME_STATE != GAME_WELCOME)
     {
-        title_font = TTF_OpenFont(font_paths[i], TITLE_FONT_SIZE);
-        subtitle_font = TTF_OpenFont(font_paths[i], SUBTITLE_FONT_SIZE);
-        if (title_font && subtitle_font)
-        {
-            break; // Successfully loaded
-        }
-        // Clean up if partially loaded
-        if (title_font) TTF_CloseFont(title_font);
-        if (subtitle_font) TTF_CloseFont(subtitle_font);
-        title_font = NULL;
-        subtitle_font = NULL;
+        drawHud(rend, VW, ST);
     }
-    
-    if (!title_font || !subtitle_font)
+    t = endPhase(P, PHASE_GLASS, t);
+
+    switch (ST->GAME_STATE)
     {
-        // If font loading fails, just return (game will still work without text)
-        if (title_font) TTF_CloseFont(title_font);
-        if (subtitle_font) TTF_CloseFont(subtitle_font);
-        return;
+    case GAME_WELCOME:
+        drawWelcomeScreen(rend, VW);
+        endPhase(P, PHASE_WELCOME, t);
+        break;
+    case ITEM_FALLING:
+    case ITEM_FALLING_FAST:
+    case ITEM_STOPPED:
+        drawItem(rend, VW, ST);
+        endPhase(P, PHASE_ITEM, t);
+        break;
+    default:
+        break;
     }
-    
-    SDL_Color text_color = {255, 255, 255, 255}; // White color
-    
-    // Render title "TETRIS"
-    SDL_Surface* title_surface = TTF_RenderText_Solid(title_font, "TETRIS", text_color);
-    if (title_surface)
+}
+
+uint64_t endPhase(tProfiler* P, tPhase phase, uint64_t start)
+{
+    uint64_t now = clock_ns();
+    addSample(P, phase, now - start);
+    return now;
+}
+
+void drawProfiler(SDL_Renderer* rend, tView* VW, const tProfiler* P)
+{
+    (void)rend;
+    // the percentiles are a scan of the buckets: once per second is enough for reading
+    if (VW->prof_frames-- <= 0)
     {
-        SDL_Texture* title_texture = SDL_CreateTextureFromSurface(rend, title_surface);
-        if (title_texture)
+        VW->prof_frames = VW->fps;
+        for (int i = 0; i < PHASE_COUNT; i++)
         {
-            int title_w, title_h;
-            SDL_QueryTexture(title_texture, NULL, NULL, &title_w, &title_h);
-            SDL_Rect title_rect = {(1200 - title_w) / 2, 250, title_w, title_h};
-            SDL_RenderCopy(rend, title_texture, NULL, &title_rect);
-            SDL_DestroyTexture(title_texture);
+            const tHist* H = &P->hist[i];
+            snprintf(VW->prof_text[i], sizeof(VW->prof_text[i]), "%-8s%6.2f%6.2f%6.2f", getPhaseName((tPhase)i),
+                     getPercentile(H, 0.5) / 1e6, getPercentile(H, 0.99) / 1e6, H->max / 1e6);
         }
-        SDL_FreeSurface(title_surface);
     }
-    
-    // Render subtitle "Press SPACE to start"
-    SDL_Surface* subtitle_surface = TTF_RenderText_Solid(subtitle_font, "Press SPACE to start", text_color);
-    if (subtitle_surface)
+    int x = VW->glass_x + VW->glass_w + HUD_FONT_SIZE;
+    drawAtlasText(&VW->TEXT, "MS       P50   P99   MAX", x, VW->glass_y);
+    for (int i = 0; i < PHASE_COUNT; i++)
     {
-        SDL_Texture* subtitle_texture = SDL_CreateTextureFromSurface(rend, subtitle_surface);
-        if (subtitle_texture)
-        {
-            int subtitle_w, subtitle_h;
-            SDL_QueryTexture(subtitle_texture, NULL, NULL, &subtitle_w, &subtitle_h);
-            SDL_Rect subtitle_rect = {(1200 - subtitle_w) / 2, 400, subtitle_w, subtitle_h};
-            SDL_RenderCopy(rend, subtitle_texture, NULL, &subtitle_rect);
-            SDL_DestroyTexture(subtitle_texture);
-        }
-        SDL_FreeSurface(subtitle_surface);
+        drawAtlasText(&VW->TEXT, VW->prof_text[i], x, VW->glass_y + (i + 1) * HUD_FONT_SIZE);
     }
-    
-    TTF_CloseFont(title_font);
-    TTF_CloseFont(subtitle_font);
 }
-
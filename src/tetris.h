@@ -4,13 +4,20 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
-// #include <unistd.h>
-#include <windows.h>
+#include <string.h>
+
+#include "ai.h"
+#include "clock.h"
+#include "log.h"
+#include "prof.h"
+#include "tetris_core.h"
+#include "text.h"
 
 // Font-related declarations
 #define FONT_PATH "spaceboy.ttf"
 #define TITLE_FONT_SIZE 72
 #define SUBTITLE_FONT_SIZE 36
+#define HUD_FONT_SIZE 24
 
 /**
  * @brief Timer data structure type
@@ -18,27 +25,28 @@
  */
 typedef struct _ttimer
 {
-    DWORD last;     //  Timestamp when the timer was fixed last time (in ms since program start)
-    int ms;         //  Timer value in ms when tick must be triggered
+    uint64_t next; // Deadline of the next tick (in ns of clock_ns())
+    int ms;        // Timer period in ms
 } tTimer;
 
 /**
- * @brief Initialize / reinitialize timer
+ * @brief Initialize / reinitialize timer, the first tick is one period later
  *
  * @param t : Timer
  */
 void timer_start(tTimer *t);
 
 /**
- * @brief Return current value of the timer t (in ms)
+ * @brief Return time passed since the last tick of the timer t (in ms)
  *
  * @param t : Timer
  * @return uint64_t Timer value
  */
-DWORD timer_check(tTimer *t);
+uint64_t timer_check(tTimer *t);
 
 /**
- * @brief Is time to tick the timer?
+ * @brief Is time to tick the timer? Every tick moves the deadline by one period,
+ * so the late ticks are caught up by calling it again (lag over 1 s is dropped)
  *
  * @param t : Timer
  * @return true : Yes
@@ -47,202 +55,151 @@ DWORD timer_check(tTimer *t);
 bool is_timer_tick(tTimer *t);
 
 /**
- * @brief Program configuration data structure
- *
- */
-typedef struct _tconfig
-{
-    int x, y; // Coordinates of window left-top corner
-    int w, h; // Window width, window height
-} tConfig;
-
-/**
- * @brief Constants for game state
- *
- */
-#define MAXITEMS 7
-#define MAXCOLORS 7
-#define ITEMBLOCKS 4
-#define GLASS_W 14
-#define GLASS_H 28
-
-/**
- * @brief Possible game state variable values
- *
- */
-typedef enum
-{
-    /*
-    @startuml
-        [*] --> GAME_WELCOME
-        GAME_WELCOME --> GAME_STARTED
-        GAME_STARTED --> ITEM_STARTED
-        ITEM_STARTED --> ITEM_FALLING
-        ITEM_FALLING --> ITEM_FALLING_FAST
-        ITEM_FALLING --> ITEM_FALLING
-        ITEM_FALLING --> ITEM_STOPPED
-        ITEM_FALLING_FAST --> ITEM_STOPPED
-        ITEM_FALLING_FAST --> ITEM_FALLING_FAST
-        ITEM_STOPPED --> ITEM_STARTED
-        ITEM_STOPPED --> GAME_FINISHED
-        GAME_FINISHED --> GAME_WELCOME
-    @enduml
-     */
-    GAME_WELCOME,      // Game welcome screen
-    GAME_STARTED,      // User started game
-    ITEM_STARTED,      // An item started to fall
-    ITEM_FALLING,      // The item falls slowly
-    ITEM_FALLING_FAST, // The item falls fast (user pressed <space>)
-    ITEM_STOPPED,      // An Item stopped falling
-    GAME_FINISHED      // The glass is full, game over
-} tGameState;
-
-/**
- * @brief Return the Game State name
- *
- * @param state : Game state variable value
- * @return const char* : Game state name
- */
-const char *getGameState(tGameState state);
-
-/**
- * @brief Game state data structure
+ * @brief Drop the missed ticks: the next deadline is the first one in the future
  *
+ * @param t : Timer
  */
-typedef struct _tstate
-{
-    uint8_t colors[MAXCOLORS][3];                    // Array of pPossible item colors
-    int8_t items[MAXITEMS][ITEMBLOCKS * ITEMBLOCKS]; // Array of possible item types
-    int fps;                                         // Frames per second for screen refresh
-    int block_size;                                  // Block size in px
-    tGameState GAME_STATE;                           // Game state variable
-    tTimer TIMER_FPS;                                // Timer for frame drawing (100/60 ms by default)
-    tTimer TIMER_1;                                  // Timer for slow falling (1000 ms by default)
-    tTimer TIMER_2;                                  // Timer for fast falling (100 ms by default)
-    int ITEM_ID;                                     // Current item
-    int glass_x, glass_y;                            // Position of left top corner of glass (in px)
-    int glass_w, glass_h;                            // Width and height of glass (in px)
-    uint8_t glass[GLASS_H][GLASS_W];                 // Array for blocks in the glass
-    int x, y;                                        // Coordinates of the falling item's left-up corner
-    int gx, gy;                     // Glass position corresponding to the left-up block of the item (in blocks)
-    int8_t marg_left[ITEMBLOCKS];   // Blocks when the item starts from the left (for each item line)
-    int8_t marg_right[ITEMBLOCKS];  // Blocks when the item ends from the left (for each item line)
-    int8_t marg_bottom[ITEMBLOCKS]; // Blocks when the item ends from the top (for each item column)
-} tState;
+void timer_sync(tTimer *t);
 
 /**
- * @brief Find the minimum of the 4 values
+ * @brief Sleep till the deadline (wakes up about 1 ms after it at most, never before)
  *
- * @return int8_t : Minimum value
+ * @param deadline : Time in ns of clock_ns()
  */
-int8_t min4(int8_t a, int8_t b, int8_t c, int8_t d);
+void timer_sleep_until(uint64_t deadline);
 
 /**
- * @brief Find the maximum of the 4 values
+ * @brief Sleep till the deadline or till an event comes, whichever is first (no busy wait)
  *
- * @return int8_t : Maximum value
+ * @param deadline : Time in ns of clock_ns()
+ * @return true : An event is waiting in the SDL queue
+ * @return false : The deadline has passed
  */
-int8_t max4(int8_t a, int8_t b, int8_t c, int8_t d);
+bool timer_wait_event_until(uint64_t deadline);
 
 /**
- * @brief Recompute depending values of item's coordinates
+ * @brief Convert the timestamp of an SDL event (ms of SDL_GetTicks()) to the time of clock_ns()
  *
- * @param ST : State data structure
+ * @param timestamp : Timestamp of the event
+ * @param now : clock_ns() value taken after the event has come
+ * @return uint64_t : Time of the event in ns of clock_ns()
  */
-void updState(tState *ST);
+uint64_t getEventTime(Uint32 timestamp, uint64_t now);
 
-/**
- * @brief Get the Bottom Margins of the item
- *
- * @param ST : State data structure
- */
-void getBottomMargins(tState *ST);
+#define INPUT_QUEUE_SIZE 32 // Maximum number of buffered player actions
 
 /**
- * @brief Get the Left Margins of the item
+ * @brief Player actions in the order of the key presses (ring buffer)
  *
- * @param ST : State data structure
  */
-void getLeftMargins(tState *ST);
+typedef struct _tinputqueue
+{
+    tAction actions[INPUT_QUEUE_SIZE]; // Buffered actions
+    int head;                          // First action
+    int count;                         // Number of actions
+} tInputQueue;
 
 /**
- * @brief Get the Right Margins of the item
+ * @brief Buffer the player action
  *
- * @param ST : State data structure
+ * @param Q : Input queue
+ * @param action : Player action
+ * @return true : The action is buffered
+ * @return false : The queue is full, the action is dropped
  */
-void getRightMargins(tState *ST);
+bool pushInput(tInputQueue *Q, tAction action);
 
 /**
- * @brief Check the touch of the left margins of the item
+ * @brief Take the oldest buffered action
  *
- * @param ST : State data structure
- * @return true
- * @return false
+ * @param Q : Input queue
+ * @param action : Taken action
+ * @return true : The action is taken
+ * @return false : The queue is empty
  */
-bool checkItemLeft(tState *ST);
+bool popInput(tInputQueue *Q, tAction *action);
 
 /**
- * @brief Check the touch of the right margins of the item
+ * @brief Drop all buffered actions
  *
- * @param ST : State data structure
- * @return true
- * @return false
+ * @param Q : Input queue
  */
-bool checkItemRight(tState *ST);
+void clearInput(tInputQueue *Q);
 
 /**
- * @brief Check the touch of the bottom margins of the item
+ * @brief Buffer the repeated moves of the held key due till the time
+ * (before a key event, so the moves keep their order with the event)
  *
- * @param ST : State data structure
- * @return true
- * @return false
+ * @param Q : Input queue
+ * @param AS : Auto-repeat
+ * @param t : Time of the key event
+ * @param max : Maximum number of moves
  */
-bool checkItemBottom(tState *ST);
+void pushShiftRepeats(tInputQueue *Q, tAutoShift *AS, uint64_t t, int max);
 
 /**
- * @brief Rotate item left
- *
- * @param ST : State data structure
- */
-void rotateItem(tState *ST);
-
-/**
- * @brief Print item array values
+ * @brief Program configuration data structure
  *
- * @param ST : State data structure
  */
-void printItem(tState *ST);
+typedef struct _tconfig
+{
+    int x, y;          // Coordinates of window left-top corner
+    int w, h;          // Window width, window height
+    bool autoplay;     // The bot plays instead of the player
+    int depth;         // Number of items the bot looks ahead
+    int beam;          // Number of boards the bot keeps at each depth
+    char record[256];  // Replay file of the last game (empty - no recording)
+    char profile[256]; // Frame profile file written on exit (empty - not written)
+    bool overlay;      // Show the frame profile (toggled by F3)
+    tGlassSize glass;  // Glass size
+    int das_ms;        // Delay before the held LEFT / RIGHT key repeats
+    int arr_ms;        // Period of the repeated moves (0 - the item slides to the wall)
+} tConfig;
 
-/**
- * @brief Copy item's blocks to glass array
- *
- * @param ST : State data structure
- */
-void copyBlocksToGlass(tState *ST);
+// Blocks of one color drawn by one call (the whole default glass)
+#define BATCH_BLOCKS (GLASS_H * GLASS_W)
 
 /**
- * @brief Print glass array values
+ * @brief Blocks to draw grouped by color (each color is drawn by one SDL_RenderFillRects call,
+ * a larger glass may take a few)
  *
- * @param ST : State data structure
  */
-void printGlass(tState *ST);
+typedef struct _tblockbatch
+{
+    SDL_Rect rects[MAXCOLORS][BATCH_BLOCKS]; // Block rectangles of every color
+    int n[MAXCOLORS];                        // Number of blocks of every color
+} tBlockBatch;
 
 /**
- * @brief Remove specified line, all lined above move down by one line
+ * @brief Game view data structure (colors, layout and timers of the window)
  *
- * @param ST : State data structure
- * @param line
  */
-void removeFullLine(tState *ST, int line);
-
-/**
- * @brief Remove full lines from the glass
+typedef struct _tview
+{
+    uint8_t colors[MAXCOLORS][3];    // Array of pPossible item colors
+    int fps;                         // Frames per second for screen refresh
+    int block_size;                  // Block size in px
+    tTimer TIMER_FPS;                // Timer for frame drawing (100/60 ms by default)
+    int glass_x, glass_y;            // Position of left top corner of glass (in px)
+    int glass_w, glass_h;            // Width and height of glass (in px)
+    tTextCache TEXT;                 // Fonts and rendered text
+    tBlockBatch BATCH;               // Blocks of the current draw call
+    SDL_Texture *GLASS_LAYER;        // Glass with the stopped blocks (render target, NULL - draw directly)
+    uint32_t glass_version;          // Version of the glass in GLASS_LAYER
+    bool glass_valid;                // GLASS_LAYER holds the glass of glass_version
+    char prof_text[PHASE_COUNT][48]; // Profile overlay lines
+    int prof_frames;                 // Frames since the overlay lines were updated
+} tView;
+
+/**
+ * @brief Set the colors, the frame rate and the glass layout of the window
  *
- * @param ST : State data structure
- * @return true
- * @return false
+ * @param VW : View data structure
+ * @param w : Window width in px
+ * @param h : Window height in px
+ * @param G : Glass size (the blocks are smaller when the glass does not fit the window)
  */
-bool checkRemoveFullLine(tState *ST);
+void initView(tView *VW, int w, int h, const tGlassSize *G);
 
 /**
  * @brief Get uint argument value
@@ -270,7 +227,9 @@ bool parse_opt_arg_uint(int argc, char **argv, int *ind, int *res);
 bool parse_opt_arg_str(int argc, char **argv, int *ind, char *res, int len);
 
 /**
- * @brief
+ * @brief Parse program arguments: -w W -h H (window size), -ai (autoplay), -depth D -beam B (bot search),
+ * -record FILE (replay of the last game), -profile FILE (frame profile, .csv or .json), -overlay (profile on screen),
+ * -glass WxH (glass size), -das MS -arr MS (held LEFT / RIGHT: delay before the repeats, their period)
  *
  * @param argc : Number of arguments passed to the program
  * @param argv : Values of arguments passed to the program
@@ -280,42 +239,81 @@ bool parse_opt_arg_str(int argc, char **argv, int *ind, char *res, int len);
 void parse_args(int argc, char **argv, tConfig *conf, SDL_DisplayMode *DM);
 
 /**
- * @brief Draw item
+ * @brief Draw item and its ghost at the landing line
  *
  * @param rend : Renderer data structure
- * @param x : X coordinate of item
- * @param y : Y coordinate of item
+ * @param VW : View data structure
  * @param ST : State data structure
  */
-void drawItem(SDL_Renderer *rend, int x, int y, tState *ST);
+void drawItem(SDL_Renderer *rend, tView *VW, tState *ST);
 
 /**
- * @brief Draw glass with blocks in it
+ * @brief Draw glass with blocks in it (from the cached layer, it is redrawn when the glass changes)
  *
  * @param rend : Renderer data structure
+ * @param VW : View data structure
  * @param ST : State data structure
  */
-void drawGlass(SDL_Renderer *rend, tState *ST);
+void drawGlass(SDL_Renderer *rend, tView *VW, tState *ST);
 
 /**
- * @brief Initialize glass array
+ * @brief Mark the cached glass layer lost (the renderer dropped the target textures)
  *
- * @param ST : State data structure
+ * @param VW : View data structure
  */
-void clearGlass(tState *ST);
+void invalidateGlass(tView *VW);
 
 /**
- * @brief Process falling step of item
+ * @brief Destroy the cached glass layer
  *
- * @param ST : State data structure
+ * @param VW : View data structure
  */
-void fallStep(tState *ST);
+void freeGlass(tView *VW);
 
 /**
  * @brief Draw welcome screen with title and subtitle
  * 
  * @param rend : Renderer data structure
+ * @param VW : View data structure
+ */
+void drawWelcomeScreen(SDL_Renderer* rend, tView* VW);
+
+/**
+ * @brief Draw the game counters (lines and items) on the left of the glass
+ *
+ * @param rend : Renderer data structure
+ * @param VW : View data structure
  * @param ST : State data structure
  */
-void drawWelcomeScreen(SDL_Renderer* rend, tState* ST);
+void drawHud(SDL_Renderer *rend, tView *VW, tState *ST);
 
+/**
+ * @brief Draw the whole frame of the game state: background, glass, counters, welcome text or the item
+ * (the same pixels in the window and in an offscreen surface)
+ *
+ * @param rend : Renderer data structure
+ * @param VW : View data structure
+ * @param ST : State data structure
+ * @param P : Profiler of the drawing phases
+ */
+void drawFrame(SDL_Renderer *rend, tView *VW, tState *ST, tProfiler *P);
+
+/**
+ * @brief Add the duration of the phase to the profile
+ *
+ * @param P : Profiler
+ * @param phase : Finished phase
+ * @param start : Start of the phase (clock_ns())
+ * @return uint64_t : Current time, the start of the next phase
+ */
+uint64_t endPhase(tProfiler *P, tPhase phase, uint64_t start);
+
+/**
+ * @brief Draw the phase durations (p50, p99 and max in ms) on the right of the glass,
+ * the numbers are updated once per second
+ *
+ * @param rend : Renderer data structure
+ * @param VW : View data structure
+ * @param P : Profiler
+ */
+void drawProfiler(SDL_Renderer *rend, tView *VW, const tProfiler *P);
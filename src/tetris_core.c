@@ -0,0 +1,1260 @@
+#include "tetris_core.h"
+
+// the line removal takes the glass width as an argument, the kernels of the common widths get their own copy of it
+#if defined(__GNUC__) || defined(__clang__)
+#define CORE_INLINE static inline __attribute__((always_inline))
+#elif defined(_MSC_VER)
+#define CORE_INLINE static __forceinline
+#else
+#define CORE_INLINE static inline
+#endif
+
+const char* getGameState(tGameState state)
+{
+    switch (state)
+    {
+    case GAME_WELCOME:
+        return "GAME_WELCOME";
+    case GAME_STARTED:
+        return "GAME_STARTED";
+    case ITEM_STARTED:
+        return "ITEM_STARTED";
+    case ITEM_FALLING:
+        return "ITEM_FALLING";
+    case ITEM_FALLING_FAST:
+        return "ITEM_FALLING_FAST";
+    case ITEM_STOPPED:
+        return "ITEM_STOPPED";
+    case GAME_FINISHED:
+        return "GAME_FINISHED";
+    }
+    return "invalid status";
+}
+
+int8_t min4(int8_t a, int8_t b, int8_t c, int8_t d)
+{
+    int8_t min = a;
+
+    if (b < min)
+    {
+        min = b;
+    }
+    if (c < min)
+    {
+        min = c;
+    }
+    if (d < min)
+    {
+        min = d;
+    }
+
+    return min;
+}
+
+int8_t max4(int8_t a, int8_t b, int8_t c, int8_t d)
+{
+    int8_t max = a;
+
+    if (b > max)
+    {
+        max = b;
+    }
+    if (c > max)
+    {
+        max = c;
+    }
+    if (d > max)
+    {
+        max = d;
+    }
+
+    return max;
+}
+
+bool initGlassSize(tGlassSize* G, int w, int h)
+{
+    if (w < ITEMBLOCKS || w > GLASS_MAX_W || h < ITEMBLOCKS || h > GLASS_MAX_H)
+    {
+        return false;
+    }
+    G->w = w;
+    G->h = h;
+    G->full = FULL_ROW(w);
+    return true;
+}
+
+bool parseGlassSize(tGlassSize* G, const char* s)
+{
+    int w, h;
+    char end;
+    return sscanf(s, "%dx%d%c", &w, &h, &end) == 2 && initGlassSize(G, w, h);
+}
+
+bool setGlassSize(tState* ST, int w, int h)
+{
+    if (!initGlassSize(&ST->size, w, h))
+    {
+        return false;
+    }
+    clearGlass(ST);
+    return true;
+}
+
+void seedRandom(tRng* R, uint64_t seed)
+{
+    // splitmix64 scrambles close seeds into unrelated generator states
+    uint64_t z = seed + 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    z ^= z >> 31;
+    R->s = z != 0 ? z : 0x9E3779B97F4A7C15ull;
+}
+
+uint32_t getRandom(tRng* R)
+{
+    R->s ^= R->s >> 12;
+    R->s ^= R->s << 25;
+    R->s ^= R->s >> 27;
+    return (uint32_t)((R->s * 0x2545F4914F6CDD1Dull) >> 32);
+}
+
+int getRandomInt(tRng* R, int n)
+{
+    return (int)(((uint64_t)getRandom(R) * (uint32_t)n) >> 32);
+}
+
+void initRandomizer(tState* ST, uint64_t seed, tRandomizer mode)
+{
+    seedRandom(&ST->rng, seed);
+    ST->randomizer = mode;
+    ST->bag_left = 0;
+}
+
+int getNextItem(tState* ST)
+{
+    if (ST->randomizer == RANDOM_UNIFORM)
+    {
+        return getRandomInt(&ST->rng, MAXITEMS);
+    }
+    if (ST->bag_left == 0)
+    {
+        // refill the bag and shuffle it (Fisher-Yates)
+        for (int i = 0; i < MAXITEMS; i++)
+        {
+            ST->bag[i] = (int8_t)i;
+        }
+        for (int i = MAXITEMS - 1; i > 0; i--)
+        {
+            int j = getRandomInt(&ST->rng, i + 1);
+            int8_t t = ST->bag[i];
+            ST->bag[i] = ST->bag[j];
+            ST->bag[j] = t;
+        }
+        ST->bag_left = MAXITEMS;
+    }
+    return ST->bag[--ST->bag_left];
+}
+
+void peekItems(const tState* ST, int* ids, int n)
+{
+    // only the generator is copied, not the glass
+    tState next;
+    next.rng = ST->rng;
+    next.randomizer = ST->randomizer;
+    memcpy(next.bag, ST->bag, sizeof(next.bag));
+    next.bag_left = ST->bag_left;
+    for (int i = 0; i < n; i++)
+    {
+        ids[i] = getNextItem(&next);
+    }
+}
+
+const tPiece* getItem(tState* ST)
+{
+    return &PIECES[ST->ITEM_ID][ST->ROTATION];
+}
+
+bool checkPieceCollision(const tGlassSize* G, const tRow* rows, const tPiece* P, int gx, int gy)
+{
+    if (gx + P->left < 0 || gx + P->right >= G->w || gy + P->top < 0 || gy + P->bottom >= G->h)
+    {
+        return true;
+    }
+    int shift = gx + P->left;
+    for (int i = P->top; i <= P->bottom; i++)
+    {
+        if (((tRow)P->rows[i] << shift) & rows[gy + i])
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool checkItemCollision(tState* ST, int gx, int gy, int rot)
+{
+    return checkPieceCollision(&ST->size, ST->rows, &PIECES[ST->ITEM_ID][rot], gx, gy);
+}
+
+bool checkItemLeft(tState* ST)
+{
+    return checkItemCollision(ST, ST->gx - 1, ST->gy, ST->ROTATION);
+}
+
+bool checkItemRight(tState* ST)
+{
+    return checkItemCollision(ST, ST->gx + 1, ST->gy, ST->ROTATION);
+}
+
+bool checkItemBottom(tState* ST)
+{
+    return checkItemCollision(ST, ST->gx, ST->gy + 1, ST->ROTATION);
+}
+
+bool moveItemLeft(tState* ST)
+{
+    if (checkItemLeft(ST))
+    {
+        return false;
+    }
+    ST->gx--;
+    return true;
+}
+
+bool moveItemRight(tState* ST)
+{
+    if (checkItemRight(ST))
+    {
+        return false;
+    }
+    ST->gx++;
+    return true;
+}
+
+bool rotateItem(tState* ST)
+{
+    int rot = (ST->ROTATION + 1) % ROTATIONS;
+    if (checkItemCollision(ST, ST->gx, ST->gy, rot))
+    {
+        return false;
+    }
+    ST->ROTATION = rot;
+    return true;
+}
+
+void printItem(tState* ST)
+{
+    const int8_t* mat = getItem(ST)->blocks;
+    for (int8_t i = 0; i < ITEMBLOCKS; i++)
+    {
+        for (int8_t j = 0; j < ITEMBLOCKS; j++)
+        {
+            printf("%d ", mat[i * ITEMBLOCKS + j]);
+        }
+        printf("\n");
+    }
+}
+
+void copyBlocksToGlass(tState* ST)
+{
+    const tPiece* P = getItem(ST);
+    // copy stopped item blocks to glass
+    for (int i = 0; i < ITEMBLOCKS; i++)
+    {
+        for (int j = 0; j < ITEMBLOCKS; j++)
+        {
+            if (P->blocks[j * ITEMBLOCKS + i] > 0)
+            {
+                GLASS_LINE(ST, ST->gy + j)[ST->gx + i] = P->blocks[j * ITEMBLOCKS + i];
+            }
+        }
+    }
+    // update the occupancy bitboard
+    for (int i = P->top; i <= P->bottom; i++)
+    {
+        ST->rows[ST->gy + i] |= (tRow)P->rows[i] << (ST->gx + P->left);
+    }
+    // the column heights: the topmost block of the item in every its column
+    for (int j = P->left; j <= P->right; j++)
+    {
+        int i = P->top;
+        while (!(P->rows[i] >> (j - P->left) & 1))
+        {
+            i++;
+        }
+        int height = ST->size.h - ST->gy - i;
+        if (ST->heights[ST->gx + j] < height)
+        {
+            ST->heights[ST->gx + j] = (uint8_t)height;
+        }
+    }
+    ST->glass_version++;
+}
+
+void updateHeights(tState* ST)
+{
+    tRow seen = 0;
+    memset(ST->heights, 0, sizeof(ST->heights));
+    // from the top down: the first block of a column is its top
+    for (int i = 0; i < ST->size.h && seen != ST->size.full; i++)
+    {
+        for (uint64_t bits = ST->rows[i] & ~seen; bits != 0; bits &= bits - 1)
+        {
+            ST->heights[lowestBit(bits)] = (uint8_t)(ST->size.h - i);
+        }
+        seen |= ST->rows[i];
+    }
+}
+
+int getLandingRow(const tState* ST, const tPiece* P, int gx, int gy)
+{
+    // the bottom block of every item column stops on the top block of the glass column
+    int land = ST->size.h;
+    for (int j = P->left; j <= P->right; j++)
+    {
+        int y = ST->size.h - ST->heights[gx + j] - 1 - P->marg_bottom[j];
+        if (y < land)
+        {
+            land = y;
+        }
+    }
+    if (land >= gy)
+    {
+        return land;
+    }
+    // under an overhang: the heights say nothing about the blocks below the item
+    while (!checkPieceCollision(&ST->size, ST->rows, P, gx, gy + 1))
+    {
+        gy++;
+    }
+    return gy;
+}
+
+void printGlass(tState* ST)
+{
+    for (int i = 0; i < ST->size.h; i++)
+    {
+        for (int j = 0; j < ST->size.w; j++)
+        {
+            printf("%d ", GLASS_LINE(ST, i)[j]);
+        }
+        printf("\n");
+    }
+    printf("\n");
+}
+
+/**
+ * @brief First occupied line of the stack above the line (the occupied lines have no empty line between them)
+ *
+ * @param ST : State data structure
+ * @param line : Glass line
+ * @param cols : Occupied columns of the lines from the stack top to the line (not including it), ORed
+ * @return int : Topmost occupied line above the line, the line itself if the line above is empty
+ */
+static int getStackTop(const tState* ST, int line, tRow* cols)
+{
+    while (line > 0 && ST->rows[line - 1] != 0)
+    {
+        line--;
+        *cols |= ST->rows[line];
+    }
+    return line;
+}
+
+void removeFullLine(tState* ST, int line)
+{
+    // only the occupied lines above move down, the empty ones stay empty
+    tRow cols = 0;
+    int top = getStackTop(ST, line, &cols);
+    int w = ST->size.w;
+    memmove(GLASS_LINE(ST, top + 1), GLASS_LINE(ST, top), (size_t)(line - top) * w);
+    memmove(&ST->rows[top + 1], &ST->rows[top], (line - top) * sizeof(ST->rows[0]));
+    memset(GLASS_LINE(ST, top), 0, w);
+    ST->rows[top] = 0;
+    ST->glass_version++;
+    updateHeights(ST);
+}
+
+/**
+ * @brief Remove the full lines touched by the stopped item in the glass of width w
+ *
+ * @param ST : State data structure
+ * @param w : Glass width (a constant in the kernels of the common widths)
+ * @return int : Number of removed lines
+ */
+CORE_INLINE int removeLinesSized(tState* ST, int w)
+{
+    const tPiece* P = getItem(ST);
+    int first = ST->gy + P->top;
+    int dst = ST->gy + P->bottom;
+
+    // only the lines touched by the stopped item can be full, compact them;
+    // above: columns occupied over the topmost full line (their top block is not removed)
+    tRow above = 0;
+    int top_full = -1;
+    for (int src = dst; src >= first; src--)
+    {
+        if (ST->rows[src] == ST->size.full)
+        {
+            above = 0;
+            top_full = src;
+            continue;
+        }
+        above |= ST->rows[src];
+        if (dst != src)
+        {
+            memcpy(ST->glass + (size_t)dst * w, ST->glass + (size_t)src * w, w);
+            ST->rows[dst] = ST->rows[src];
+        }
+        dst--;
+    }
+
+    int lines = dst - first + 1;
+    if (lines > 0)
+    {
+        // move the occupied lines above the item down in one pass, the lines over the stack are empty
+        int top = getStackTop(ST, first, &above);
+        memmove(ST->glass + (size_t)(top + lines) * w, ST->glass + (size_t)top * w, (size_t)(first - top) * w);
+        memmove(&ST->rows[top + lines], &ST->rows[top], (first - top) * sizeof(ST->rows[0]));
+        memset(ST->glass + (size_t)top * w, 0, (size_t)lines * w);
+        memset(&ST->rows[top], 0, lines * sizeof(ST->rows[0]));
+        ST->lines += lines;
+        ST->glass_version++;
+
+        // every removed line is full: a column goes down by the number of lines unless its top
+        // block was in the topmost full line, then it is found again below (the holes are not removed);
+        // no column is lower than the number of lines, so 8 columns go down at once without a borrow
+        static const uint8_t ONES[16] = {1, 1, 1, 1, 1, 1, 1, 1};
+        for (int j = 0; j < w; j += 8)
+        {
+            uint64_t x, m;
+            // one per column of the word, zero over the glass width
+            memcpy(&m, ONES + (w - j >= 8 ? 0 : 8 - (w - j)), 8);
+            memcpy(&x, ST->heights + j, 8);
+            x -= m * (uint64_t)lines;
+            memcpy(ST->heights + j, &x, 8);
+        }
+        for (uint64_t bits = ST->size.full & ~above; bits != 0; bits &= bits - 1)
+        {
+            int j = lowestBit(bits);
+            int i = top_full;
+            while (i < ST->size.h && !(ST->rows[i] >> j & 1))
+            {
+                i++;
+            }
+            ST->heights[j] = (uint8_t)(ST->size.h - i);
+        }
+    }
+    return lines;
+}
+
+int checkRemoveFullLine(tState* ST)
+{
+    switch (ST->size.w)
+    {
+#if GLASS_MAX_W >= 14
+    case 10:
+        return removeLinesSized(ST, 10);
+    case 14:
+        return removeLinesSized(ST, 14);
+#endif
+    default:
+        return removeLinesSized(ST, ST->size.w);
+    }
+}
+
+void clearGlass(tState* ST)
+{
+    // only the lines of the glass size are used (and the rest of their last word, see getColorSpan())
+    memset(ST->glass, 0, ((size_t)ST->size.h * ST->size.w + 7) & ~(size_t)7);
+    memset(ST->rows, 0, ST->size.h * sizeof(ST->rows[0]));
+    memset(ST->heights, 0, sizeof(ST->heights));
+    ST->glass_version++;
+}
+
+int removeFullRows(const tGlassSize* G, tRow* rows)
+{
+    int dst = G->h - 1;
+    int src = G->h - 1;
+    // the lines above the first empty one are empty too
+    for (; src >= 0 && rows[src] != 0; src--)
+    {
+        if (rows[src] != G->full)
+        {
+            rows[dst--] = rows[src];
+        }
+    }
+    int lines = dst - src;
+    for (; dst > src; dst--)
+    {
+        rows[dst] = 0;
+    }
+    return lines;
+}
+
+void newGame(tState* ST)
+{
+    if (ST->size.w == 0)
+    {
+        initGlassSize(&ST->size, GLASS_W, GLASS_H);
+    }
+    clearGlass(ST);
+    ST->lines = 0;
+    ST->items = 0;
+    ST->ITEM_ID = -1;
+    ST->GAME_STATE = GAME_STARTED;
+}
+
+bool spawnItem(tState* ST, int id)
+{
+    ST->ITEM_ID = id;
+    ST->ROTATION = 0;
+    ST->gx = (ST->size.w - ITEMBLOCKS) / 2;
+    ST->gy = 0;
+    if (checkItemCollision(ST, ST->gx, ST->gy, ST->ROTATION))
+    {
+        ST->GAME_STATE = GAME_FINISHED;
+        return false;
+    }
+    ST->GAME_STATE = ITEM_FALLING;
+    ST->items++;
+    return true;
+}
+
+void dropItem(tState* ST)
+{
+    ST->GAME_STATE = ITEM_FALLING_FAST;
+}
+
+void hardDropItem(tState* ST)
+{
+    ST->gy = getLandingRow(ST, getItem(ST), ST->gx, ST->gy);
+    lockItem(ST);
+}
+
+void lockItem(tState* ST)
+{
+    copyBlocksToGlass(ST);
+    ST->GAME_STATE = ITEM_STOPPED;
+}
+
+void fallStep(tState* ST)
+{
+    if (checkItemBottom(ST))
+    {
+        lockItem(ST);
+    }
+    else
+    {
+        ST->gy++;
+    }
+}
+
+void initClock(tGameClock* C, uint32_t fall_ms, uint32_t fast_ms, uint32_t spawn_ms)
+{
+    memset(C, 0, sizeof(*C));
+    C->fall_ms = fall_ms;
+    C->fast_ms = fast_ms;
+    C->spawn_ms = spawn_ms;
+}
+
+void startTimedGame(tState* ST, tGameClock* C)
+{
+    newGame(ST);
+    ST->GAME_STATE = ITEM_STARTED;
+    C->now = 0;
+    C->next_fall = C->fall_ms;
+    C->next_fast = C->fast_ms;
+    C->next_spawn = C->spawn_ms;
+}
+
+void advanceGame(tState* ST, tGameClock* C, uint32_t now)
+{
+    bool finished = ST->GAME_STATE == GAME_FINISHED;
+    for (;;)
+    {
+        uint32_t t = getNextTick(ST, C);
+        bool spawn = ST->GAME_STATE == ITEM_STARTED && C->next_spawn == t && t < C->next_fall && t < C->next_fast;
+        if (t > now)
+        {
+            break;
+        }
+        C->now = t;
+        if (spawn)
+        {
+            // the first fall is one full period after the item appears
+            if (spawnItem(ST, getNextItem(ST)))
+            {
+                C->next_fall = t + C->fall_ms;
+            }
+        }
+        else if (t == C->next_fall)
+        {
+            C->next_fall += C->fall_ms;
+            if (ST->GAME_STATE == ITEM_FALLING)
+            {
+                fallStep(ST);
+            }
+            else if (ST->GAME_STATE == GAME_FINISHED)
+            {
+                ST->GAME_STATE = GAME_WELCOME;
+            }
+        }
+        else
+        {
+            C->next_fast += C->fast_ms;
+            if (ST->GAME_STATE == ITEM_FALLING_FAST)
+            {
+                fallStep(ST);
+            }
+            else if (ST->GAME_STATE == ITEM_STOPPED)
+            {
+                checkRemoveFullLine(ST);
+                ST->GAME_STATE = ITEM_STARTED;
+                C->next_spawn = t + C->spawn_ms;
+            }
+        }
+        if (!finished && ST->GAME_STATE == GAME_FINISHED)
+        {
+            // stop at the end of the game, the caller sees the final glass at C->now
+            return;
+        }
+    }
+    C->now = now;
+}
+
+uint32_t getNextTick(const tState* ST, const tGameClock* C)
+{
+    uint32_t t = C->next_fall < C->next_fast ? C->next_fall : C->next_fast;
+    if (ST->GAME_STATE == ITEM_STARTED && C->next_spawn < t)
+    {
+        t = C->next_spawn;
+    }
+    return t;
+}
+
+void initAutoShift(tAutoShift* AS, uint32_t das_ms, uint32_t arr_ms)
+{
+    memset(AS, 0, sizeof(*AS));
+    AS->das_ns = (uint64_t)das_ms * 1000000;
+    AS->arr_ns = (uint64_t)arr_ms * 1000000;
+    AS->held = ACTION_NONE;
+}
+
+void pressShift(tAutoShift* AS, tAction action, uint64_t t)
+{
+    if (action == ACTION_LEFT)
+    {
+        AS->left = true;
+    }
+    else if (action == ACTION_RIGHT)
+    {
+        AS->right = true;
+    }
+    else
+    {
+        return;
+    }
+    // the last pressed key wins
+    AS->held = action;
+    AS->next = t + AS->das_ns;
+}
+
+void releaseShift(tAutoShift* AS, tAction action, uint64_t t)
+{
+    if (action == ACTION_LEFT)
+    {
+        AS->left = false;
+    }
+    else if (action == ACTION_RIGHT)
+    {
+        AS->right = false;
+    }
+    else
+    {
+        return;
+    }
+    if (AS->held != action)
+    {
+        return;
+    }
+    // the key still held takes over with its own delay
+    AS->held = AS->left ? ACTION_LEFT : AS->right ? ACTION_RIGHT : ACTION_NONE;
+    AS->next = t + AS->das_ns;
+}
+
+int takeShiftRepeats(tAutoShift* AS, uint64_t now, int max)
+{
+    if (AS->held == ACTION_NONE || now < AS->next || max <= 0)
+    {
+        return 0;
+    }
+    if (AS->arr_ns == 0)
+    {
+        // the deadline stays in the past: the item is pushed to the wall on every call
+        return max;
+    }
+    uint64_t n = (now - AS->next) / AS->arr_ns + 1;
+    AS->next += n * AS->arr_ns;
+    return n < (uint64_t)max ? (int)n : max;
+}
+
+uint64_t getNextShift(const tAutoShift* AS)
+{
+    return AS->held == ACTION_NONE ? UINT64_MAX : AS->next;
+}
+
+// item position packed into 16 bits: column and line (from 1 - ITEMBLOCKS) and rotation, no division to unpack
+#if GLASS_MAX_W + ITEMBLOCKS > 128 || GLASS_MAX_H + ITEMBLOCKS > 128
+#error "the packed item position has 7 bits for the column and the line"
+#endif
+#define POS_PACK(gx, gy, rot) ((rot) << 14 | ((gy) + ITEMBLOCKS - 1) << 7 | ((gx) + ITEMBLOCKS - 1))
+#define POS_X(pos) (((pos) & 127) - (ITEMBLOCKS - 1))
+#define POS_Y(pos) (((pos) >> 7 & 127) - (ITEMBLOCKS - 1))
+#define POS_ROT(pos) ((pos) >> 14)
+
+// index of the item position in the search arrays (the ranges of the glass size G)
+#define POS_INDEX(G, gx, gy, rot)                                                                                      \
+    ((((rot) * ((G)->h + ITEMBLOCKS - 1)) + (gy) + ITEMBLOCKS - 1) * ((G)->w + ITEMBLOCKS - 1) + (gx) + ITEMBLOCKS - 1)
+
+/**
+ * @brief Clear the bitset of the item positions of the glass size
+ *
+ * @param G : Glass size
+ * @param visited : Bitset, MAXPLACEMENTS bits
+ */
+static void clearPositions(const tGlassSize* G, uint64_t* visited)
+{
+    int n = ROTATIONS * (G->w + ITEMBLOCKS - 1) * (G->h + ITEMBLOCKS - 1);
+    memset(visited, 0, (size_t)(n + 63) / 64 * sizeof(uint64_t));
+}
+
+/**
+ * @brief Breadth-first search of all item positions reachable from the start position
+ *
+ * @param G : Glass size
+ * @param rows : Occupancy bitboard of the glass
+ * @param id : Item
+ * @param gx, gy, rot : Start position
+ * @param queue : Reached positions (POS_PACK) in the search order, MAXPLACEMENTS size
+ * @param parent : Previous position (POS_PACK) for each reached position (POS_INDEX, may be NULL), MAXPLACEMENTS size
+ * @param visited : Bitset of reached positions (POS_INDEX), cleared by clearPositions()
+ * @return int : Number of reached positions
+ */
+static int searchPositions(const tGlassSize* G, const tRow* rows, int id, int gx, int gy, int rot, uint16_t* queue,
+                           uint16_t* parent, uint64_t* visited)
+{
+    int head = 0, tail = 0;
+    if (checkPieceCollision(G, rows, &PIECES[id][rot], gx, gy))
+    {
+        return 0;
+    }
+    int start = POS_INDEX(G, gx, gy, rot);
+    visited[start >> 6] |= 1ull << (start & 63);
+    queue[tail++] = (uint16_t)POS_PACK(gx, gy, rot);
+    while (head < tail)
+    {
+        int pos = queue[head++];
+        int x = POS_X(pos);
+        int y = POS_Y(pos);
+        int r = POS_ROT(pos);
+        // left, right, rotate, down
+        const int moves[4][3] = {{x - 1, y, r}, {x + 1, y, r}, {x, y, (r + 1) % ROTATIONS}, {x, y + 1, r}};
+        for (int k = 0; k < 4; k++)
+        {
+            if (checkPieceCollision(G, rows, &PIECES[id][moves[k][2]], moves[k][0], moves[k][1]))
+            {
+                continue;
+            }
+            int next = POS_INDEX(G, moves[k][0], moves[k][1], moves[k][2]);
+            if (visited[next >> 6] & (1ull << (next & 63)))
+            {
+                continue;
+            }
+            visited[next >> 6] |= 1ull << (next & 63);
+            if (parent)
+            {
+                parent[next] = (uint16_t)pos;
+            }
+            queue[tail++] = (uint16_t)POS_PACK(moves[k][0], moves[k][1], moves[k][2]);
+        }
+    }
+    return tail;
+}
+
+int findPlacements(const tGlassSize* G, const tRow* rows, int id, int gx, int gy, int rot, tPlacement* out, int max)
+{
+    uint16_t queue[MAXPLACEMENTS];
+    uint64_t visited[(MAXPLACEMENTS + 63) / 64];
+    uint64_t found[(ROTATIONS * GLASS_MAX_H * GLASS_MAX_W + 63) / 64];
+    clearPositions(G, visited);
+    memset(found, 0, (size_t)(ROTATIONS * G->h * G->w + 63) / 64 * sizeof(uint64_t));
+    int reached = searchPositions(G, rows, id, gx, gy, rot, queue, NULL, visited);
+    int n = 0;
+
+    for (int i = 0; i < reached && n < max; i++)
+    {
+        int x = POS_X(queue[i]);
+        int y = POS_Y(queue[i]);
+        int r = POS_ROT(queue[i]);
+        const tPiece* P = &PIECES[id][r];
+        if (!checkPieceCollision(G, rows, P, x, y + 1))
+        {
+            continue;
+        }
+        // the same blocks in the glass are reported once
+        int key = (P->shape * G->h + y + P->top) * G->w + x + P->left;
+        if (found[key >> 6] & (1ull << (key & 63)))
+        {
+            continue;
+        }
+        found[key >> 6] |= 1ull << (key & 63);
+        out[n].gx = (int8_t)x;
+        out[n].gy = (int8_t)y;
+        out[n].rot = (int8_t)r;
+        n++;
+    }
+    return n;
+}
+
+int getPlacements(tState* ST, tPlacement* out, int max)
+{
+    return findPlacements(&ST->size, ST->rows, ST->ITEM_ID, ST->gx, ST->gy, ST->ROTATION, out, max);
+}
+
+void placeItem(tRow* rows, int id, const tPlacement* pl)
+{
+    const tPiece* P = &PIECES[id][pl->rot];
+    for (int i = P->top; i <= P->bottom; i++)
+    {
+        rows[pl->gy + i] |= (tRow)P->rows[i] << (pl->gx + P->left);
+    }
+}
+
+int findPlacementPath(const tGlassSize* G, const tRow* rows, int id, int gx, int gy, int rot, const tPlacement* target,
+                      tAction* path, int max)
+{
+    uint16_t queue[MAXPLACEMENTS];
+    uint16_t parent[MAXPLACEMENTS];
+    uint64_t visited[(MAXPLACEMENTS + 63) / 64];
+    clearPositions(G, visited);
+    searchPositions(G, rows, id, gx, gy, rot, queue, parent, visited);
+
+    if (checkPieceCollision(G, rows, &PIECES[id][target->rot], target->gx, target->gy))
+    {
+        return -1;
+    }
+    int index = POS_INDEX(G, target->gx, target->gy, target->rot);
+    if (!(visited[index >> 6] & (1ull << (index & 63))))
+    {
+        return -1;
+    }
+
+    // walk back to the start, the actions are collected from the end of the path
+    int start = POS_PACK(gx, gy, rot);
+    int pos = POS_PACK(target->gx, target->gy, target->rot);
+    int n = 0;
+    for (int p = pos; p != start; p = parent[POS_INDEX(G, POS_X(p), POS_Y(p), POS_ROT(p))])
+    {
+        n++;
+    }
+    if (n > max)
+    {
+        return -1;
+    }
+    for (int p = pos, i = n - 1; p != start; i--)
+    {
+        int prev = parent[POS_INDEX(G, POS_X(p), POS_Y(p), POS_ROT(p))];
+        if (POS_ROT(prev) != POS_ROT(p))
+        {
+            path[i] = ACTION_ROTATE;
+        }
+        else if (p == prev - 1)
+        {
+            path[i] = ACTION_LEFT;
+        }
+        else if (p == prev + 1)
+        {
+            path[i] = ACTION_RIGHT;
+        }
+        else
+        {
+            path[i] = ACTION_NONE;
+        }
+        p = prev;
+    }
+    return n;
+}
+
+bool applyAction(tState* ST, tAction action)
+{
+    switch (action)
+    {
+    case ACTION_LEFT:
+        return moveItemLeft(ST);
+    case ACTION_RIGHT:
+        return moveItemRight(ST);
+    case ACTION_ROTATE:
+        return rotateItem(ST);
+    case ACTION_DROP:
+        dropItem(ST);
+        return true;
+    case ACTION_HARD_DROP:
+        hardDropItem(ST);
+        return true;
+    case ACTION_NONE:
+        break;
+    }
+    return false;
+}
+
+void playGame(tState* ST, tPolicy policy, void* ctx, int max_items)
+{
+    newGame(ST);
+    while ((max_items <= 0 || ST->items < max_items) && spawnItem(ST, getNextItem(ST)))
+    {
+        while (ST->GAME_STATE == ITEM_FALLING || ST->GAME_STATE == ITEM_FALLING_FAST)
+        {
+            for (int m = 0; m < MAXMOVES(&ST->size) && ST->GAME_STATE == ITEM_FALLING; m++)
+            {
+                tAction action = policy(ST, ctx);
+                if (!applyAction(ST, action) || action == ACTION_DROP)
+                {
+                    break;
+                }
+            }
+            if (ST->GAME_STATE == ITEM_FALLING_FAST)
+            {
+                // no moves while the item falls fast: it goes down to the landing line at once
+                hardDropItem(ST);
+            }
+            else if (ST->GAME_STATE == ITEM_FALLING)
+            {
+                fallStep(ST);
+            }
+        }
+        checkRemoveFullLine(ST);
+    }
+}
+
+/**
+ * @brief Get the number of occupied lines at the bottom of the glass (the highest column)
+ *
+ * @param ST : State data structure
+ * @return int : Number of lines
+ */
+static int getStackLines(const tState* ST)
+{
+    int used = 0;
+    for (int j = 0; j < ST->size.w; j++)
+    {
+        used = ST->heights[j] > used ? ST->heights[j] : used;
+    }
+    return used;
+}
+
+/**
+ * @brief Colors of the occupied lines in the snapshot: the packed lines from the stack top to the
+ * bottom, widened to whole words (the bytes out of the lines are zero, clearGlass() clears the last word)
+ *
+ * @param w, h : Glass size
+ * @param used : Number of occupied lines
+ * @param start : Offset of the first word in tState.glass
+ * @return size_t : Number of bytes (a multiple of 8)
+ */
+static size_t getColorSpan(int w, int h, int used, size_t* start)
+{
+    *start = ((size_t)(h - used) * w) & ~(size_t)7;
+    return (((size_t)h * w + 7) & ~(size_t)7) - *start;
+}
+
+size_t getSnapshotSize(const tState* ST)
+{
+    size_t start;
+    int used = getStackLines(ST);
+    return sizeof(tSnapshot) + SNAPSHOT_STRIDE(ST->size.w) + used * sizeof(tRow) +
+           getColorSpan(ST->size.w, ST->size.h, used, &start);
+}
+
+/**
+ * @brief Save the snapshot header and the column heights (SNAPSHOT_STRIDE() bytes after the header)
+ *
+ * @param ST : State data structure
+ * @param S : Snapshot header
+ * @param used : Number of occupied lines
+ */
+static void saveHeader(const tState* ST, tSnapshot* S, int used)
+{
+    S->rng = ST->rng;
+    S->lines = ST->lines;
+    S->items = ST->items;
+    memcpy(S->bag, ST->bag, sizeof(S->bag));
+    S->bag_left = (int8_t)ST->bag_left;
+    S->game_state = (int8_t)ST->GAME_STATE;
+    S->randomizer = (int8_t)ST->randomizer;
+    S->item = (int8_t)ST->ITEM_ID;
+    S->rot = (int8_t)ST->ROTATION;
+    S->gx = (int8_t)ST->gx;
+    S->gy = (int8_t)ST->gy;
+    S->w = (uint8_t)ST->size.w;
+    S->h = (uint8_t)ST->size.h;
+    S->used = (uint8_t)used;
+
+    // copied by words: a memcpy() of a variable length is slow for a few bytes
+    uint8_t* heights = (uint8_t*)(S + 1);
+    for (int j = 0; j < SNAPSHOT_STRIDE(ST->size.w); j += 8)
+    {
+        memcpy(heights + j, ST->heights + j, 8);
+    }
+}
+
+/**
+ * @brief Restore the snapshot header and the column heights
+ *
+ * @param ST : State data structure
+ * @param S : Snapshot header
+ * @return true : The state is restored
+ * @return false : The snapshot is of another glass size (or it is broken), the state is not changed
+ */
+static bool restoreHeader(tState* ST, const tSnapshot* S)
+{
+    if (S->w != ST->size.w || S->h != ST->size.h || S->w > GLASS_MAX_W || S->h > GLASS_MAX_H || S->used > S->h)
+    {
+        return false;
+    }
+    const uint8_t* heights = (const uint8_t*)(S + 1);
+    for (int j = 0; j < SNAPSHOT_STRIDE(S->w); j += 8)
+    {
+        memcpy(ST->heights + j, heights + j, 8);
+    }
+    ST->rng = S->rng;
+    ST->lines = S->lines;
+    ST->items = S->items;
+    memcpy(ST->bag, S->bag, sizeof(ST->bag));
+    ST->bag_left = S->bag_left;
+    ST->GAME_STATE = (tGameState)S->game_state;
+    ST->randomizer = (tRandomizer)S->randomizer;
+    ST->ITEM_ID = S->item;
+    ST->ROTATION = S->rot;
+    ST->gx = S->gx;
+    ST->gy = S->gy;
+    ST->glass_version++;
+    return true;
+}
+
+size_t saveSnapshot(const tState* ST, void* buf)
+{
+    tSnapshot* S = buf;
+    int used = getStackLines(ST);
+    int first = ST->size.h - used;
+    int stride = SNAPSHOT_STRIDE(ST->size.w);
+    size_t start, n = getColorSpan(ST->size.w, ST->size.h, used, &start);
+    saveHeader(ST, S, used);
+
+    // after the column heights: the bitboard rows of the occupied lines, then their colors (by words)
+    tRow* rows = (tRow*)((uint8_t*)(S + 1) + stride);
+    uint8_t* colors = (uint8_t*)(rows + used);
+    for (int i = 0; i < used; i++)
+    {
+        rows[i] = ST->rows[first + i];
+    }
+    for (size_t k = 0; k < n; k += 8)
+    {
+        memcpy(colors + k, ST->glass + start + k, 8);
+    }
+    return sizeof(tSnapshot) + stride + used * sizeof(tRow) + n;
+}
+
+bool restoreSnapshot(tState* ST, const void* buf)
+{
+    const tSnapshot* S = buf;
+    int top = ST->size.h - getStackLines(ST);
+    if (!restoreHeader(ST, S))
+    {
+        return false;
+    }
+    int first = S->h - S->used;
+    if (top < first)
+    {
+        // occupied now, empty in the snapshot
+        memset(GLASS_LINE(ST, top), 0, (size_t)(first - top) * S->w);
+        memset(&ST->rows[top], 0, (first - top) * sizeof(ST->rows[0]));
+    }
+    size_t start, n = getColorSpan(S->w, S->h, S->used, &start);
+    const tRow* rows = (const tRow*)((const uint8_t*)(S + 1) + SNAPSHOT_STRIDE(S->w));
+    const uint8_t* colors = (const uint8_t*)(rows + S->used);
+    for (int i = 0; i < S->used; i++)
+    {
+        ST->rows[first + i] = rows[i];
+    }
+    for (size_t k = 0; k < n; k += 8)
+    {
+        memcpy(ST->glass + start + k, colors + k, 8);
+    }
+    return true;
+}
+
+/**
+ * @brief Get the size of the fork
+ *
+ * @param w : Glass width
+ * @param used : Number of occupied lines
+ * @return size_t : Fork size in bytes (the rows are rounded up to whole words)
+ */
+static size_t getForkBytes(int w, int used)
+{
+    size_t rows = (size_t)used * FORK_ROW_BYTES(w);
+    return sizeof(tSnapshot) + SNAPSHOT_STRIDE(w) + ((rows + 7) & ~(size_t)7);
+}
+
+size_t getForkSize(const tState* ST)
+{
+    return getForkBytes(ST->size.w, getStackLines(ST));
+}
+
+size_t saveFork(const tState* ST, void* buf)
+{
+    tSnapshot* S = buf;
+    int used = getStackLines(ST);
+    const tRow* src = &ST->rows[ST->size.h - used];
+    uint8_t* dst = (uint8_t*)(S + 1) + SNAPSHOT_STRIDE(ST->size.w);
+    saveHeader(ST, S, used);
+
+    // the rows in words of the glass width, whatever the width of tRow is
+    switch (FORK_ROW_BYTES(ST->size.w))
+    {
+    case 1:
+        for (int i = 0; i < used; i++)
+        {
+            dst[i] = (uint8_t)src[i];
+        }
+        break;
+    case 2:
+        for (int i = 0; i < used; i++)
+        {
+            uint16_t row = (uint16_t)src[i];
+            memcpy(dst + 2 * i, &row, 2);
+        }
+        break;
+    case 4:
+        for (int i = 0; i < used; i++)
+        {
+            uint32_t row = (uint32_t)src[i];
+            memcpy(dst + 4 * i, &row, 4);
+        }
+        break;
+    default:
+        for (int i = 0; i < used; i++)
+        {
+            uint64_t row = (uint64_t)src[i];
+            memcpy(dst + 8 * i, &row, 8);
+        }
+        break;
+    }
+    return getForkBytes(ST->size.w, used);
+}
+
+bool restoreFork(tState* ST, const void* buf)
+{
+    const tSnapshot* S = buf;
+    int top = ST->size.h - getStackLines(ST);
+    if (!restoreHeader(ST, S))
+    {
+        return false;
+    }
+    int first = S->h - S->used;
+    if (top < first)
+    {
+        memset(&ST->rows[top], 0, (first - top) * sizeof(ST->rows[0]));
+    }
+    const uint8_t* src = (const uint8_t*)(S + 1) + SNAPSHOT_STRIDE(S->w);
+    tRow* dst = &ST->rows[first];
+    switch (FORK_ROW_BYTES(S->w))
+    {
+    case 1:
+        for (int i = 0; i < S->used; i++)
+        {
+            dst[i] = src[i];
+        }
+        break;
+    case 2:
+        for (int i = 0; i < S->used; i++)
+        {
+            uint16_t row;
+            memcpy(&row, src + 2 * i, 2);
+            dst[i] = (tRow)row;
+        }
+        break;
+    case 4:
+        for (int i = 0; i < S->used; i++)
+        {
+            uint32_t row;
+            memcpy(&row, src + 4 * i, 4);
+            dst[i] = (tRow)row;
+        }
+        break;
+    default:
+        for (int i = 0; i < S->used; i++)
+        {
+            uint64_t row;
+            memcpy(&row, src + 8 * i, 8);
+            dst[i] = (tRow)row;
+        }
+        break;
+    }
+    return true;
+}
+
+bool initUndo(tUndoStack* U, size_t size)
+{
+    U->top = 0;
+    U->count = 0;
+    return initArena(&U->arena, size);
+}
+
+void freeUndo(tUndoStack* U)
+{
+    freeArena(&U->arena);
+    U->top = 0;
+    U->count = 0;
+}
+
+void clearUndo(tUndoStack* U)
+{
+    resetArena(&U->arena);
+    U->top = 0;
+    U->count = 0;
+}
+
+bool pushUndo(tUndoStack* U, const tState* ST)
+{
+    // record: offset of the previous record, then the snapshot
+    size_t mark = U->arena.used;
+    uint64_t* record = allocArena(&U->arena, sizeof(uint64_t) + getSnapshotSize(ST));
+    if (!record)
+    {
+        return false;
+    }
+    *record = U->top;
+    saveSnapshot(ST, record + 1);
+    U->top = mark;
+    U->count++;
+    return true;
+}
+
+bool popUndo(tUndoStack* U, tState* ST)
+{
+    if (U->count == 0)
+    {
+        return false;
+    }
+    const uint64_t* record = (const uint64_t*)(U->arena.base + U->top);
+    if (!restoreSnapshot(ST, record + 1))
+    {
+        return false;
+    }
+    releaseArena(&U->arena, U->top);
+    U->top = (size_t)*record;
+    U->count--;
+    return true;
+}
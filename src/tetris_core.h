@@ -0,0 +1,911 @@
+#ifndef TETRIS_CORE_H
+#define TETRIS_CORE_H
+
+// Game engine: no SDL and no OS dependent headers here
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "arena.h"
+
+/**
+ * @brief Constants for game state
+ *
+ */
+#define MAXITEMS 7
+#define MAXCOLORS 7
+#define ITEMBLOCKS 4
+#define ROTATIONS 4
+#define GLASS_W 14 // Default glass width
+#define GLASS_H 28 // Default glass height
+
+/**
+ * @brief Largest glass (the size of the glass arrays), the glass size itself is chosen at run time
+ *
+ * A build with -DGLASS_MAX_W=16 keeps the glass rows in 16 bits.
+ */
+#ifndef GLASS_MAX_W
+#define GLASS_MAX_W 64
+#endif
+#ifndef GLASS_MAX_H
+#define GLASS_MAX_H 64
+#endif
+
+/**
+ * @brief Glass row bitmask type (bit j is set when column j of the row is occupied)
+ *
+ */
+#if GLASS_MAX_W <= 16
+typedef uint16_t tRow;
+#elif GLASS_MAX_W <= 32
+typedef uint32_t tRow;
+#elif GLASS_MAX_W <= 64
+typedef uint64_t tRow;
+#else
+#error "GLASS_MAX_W is over 64"
+#endif
+
+/**
+ * @brief Glass size data structure
+ *
+ */
+typedef struct _tglasssize
+{
+    int w, h;  // Glass width and height in blocks
+    tRow full; // Bitmask of the completely filled row
+} tGlassSize;
+
+/**
+ * @brief Bitmask of the completely filled row of the glass of width w
+ *
+ */
+#define FULL_ROW(w) ((tRow)(~(uint64_t)0 >> (64 - (w))))
+
+/**
+ * @brief Item rotation data structure (precomputed for every item and rotation)
+ *
+ */
+typedef struct _tpiece
+{
+    int8_t blocks[ITEMBLOCKS * ITEMBLOCKS]; // Item blocks (color index, 0 - no block)
+    int8_t marg_left[ITEMBLOCKS];           // Blocks when the item starts from the left (for each item line)
+    int8_t marg_right[ITEMBLOCKS];          // Blocks when the item ends from the left (for each item line)
+    int8_t marg_bottom[ITEMBLOCKS];         // Blocks when the item ends from the top (for each item column)
+    uint8_t rows[ITEMBLOCKS];               // Item line bitmasks shifted right by left (bit 0 - leftmost column)
+    int8_t left, right;                     // Leftmost and rightmost item columns
+    int8_t top, bottom;                     // Topmost and bottommost item lines
+    int8_t shape;                           // First rotation with the same blocks (up to a shift)
+} tPiece;
+
+/**
+ * @brief Table of all rotations of all items (generated by tools/genpieces.c)
+ *
+ * Rotation r + 1 is rotation r rotated left.
+ */
+extern const tPiece PIECES[MAXITEMS][ROTATIONS];
+
+/**
+ * @brief Possible game state variable values
+ *
+ */
+typedef enum
+{
+    /*
+    @startuml
+        [*] --> GAME_WELCOME
+        GAME_WELCOME --> GAME_STARTED
+        GAME_STARTED --> ITEM_STARTED
+        ITEM_STARTED --> ITEM_FALLING
+        ITEM_FALLING --> ITEM_FALLING_FAST
+        ITEM_FALLING --> ITEM_FALLING
+        ITEM_FALLING --> ITEM_STOPPED
+        ITEM_FALLING_FAST --> ITEM_STOPPED
+        ITEM_FALLING_FAST --> ITEM_FALLING_FAST
+        ITEM_STOPPED --> ITEM_STARTED
+        ITEM_STARTED --> GAME_FINISHED
+        GAME_FINISHED --> GAME_WELCOME
+    @enduml
+     */
+    GAME_WELCOME,      // Game welcome screen
+    GAME_STARTED,      // User started game
+    ITEM_STARTED,      // An item started to fall
+    ITEM_FALLING,      // The item falls slowly
+    ITEM_FALLING_FAST, // The item falls fast (user pressed <space>)
+    ITEM_STOPPED,      // An Item stopped falling
+    GAME_FINISHED      // The glass is full (no room for a new item), game over
+} tGameState;
+
+/**
+ * @brief Return the Game State name
+ *
+ * @param state : Game state variable value
+ * @return const char* : Game state name
+ */
+const char *getGameState(tGameState state);
+
+/**
+ * @brief Player actions on the falling item
+ *
+ */
+typedef enum
+{
+    ACTION_NONE,     // Do nothing
+    ACTION_LEFT,     // Move item left
+    ACTION_RIGHT,    // Move item right
+    ACTION_ROTATE,   // Rotate item left
+    ACTION_DROP,     // Drop item (it falls fast till it stops)
+    ACTION_HARD_DROP // Hard drop (the item moves to its landing line and stops at once)
+} tAction;
+
+/**
+ * @brief Final item placement in the glass
+ *
+ */
+typedef struct _tplacement
+{
+    int8_t gx, gy; // Glass position corresponding to the left-up block of the item (in blocks)
+    int8_t rot;    // Item rotation
+} tPlacement;
+
+/**
+ * @brief Ranges of the item positions (gx, gy >= 1 - ITEMBLOCKS) and the enough size of placement arrays
+ *
+ */
+#define POS_W (GLASS_MAX_W + ITEMBLOCKS - 1)
+#define POS_H (GLASS_MAX_H + ITEMBLOCKS - 1)
+#define MAXPLACEMENTS (ROTATIONS * POS_W * POS_H)
+
+/**
+ * @brief Random generator data structure (xorshift64*)
+ *
+ */
+typedef struct _trng
+{
+    uint64_t s; // Generator state (never 0)
+} tRng;
+
+/**
+ * @brief Possible ways to choose the next item
+ *
+ */
+typedef enum
+{
+    RANDOM_UNIFORM, // Every item is chosen independently
+    RANDOM_BAG      // Items are dealt from a shuffled bag of all 7 items
+} tRandomizer;
+
+/**
+ * @brief Game state data structure
+ *
+ */
+typedef struct _tstate
+{
+    tGameState GAME_STATE;                   // Game state variable
+    int ITEM_ID;                             // Current item
+    int ROTATION;                            // Current item rotation (index in PIECES[ITEM_ID])
+    tGlassSize size;                         // Glass size (0 - the default one is set by newGame())
+    uint8_t glass[GLASS_MAX_H * GLASS_MAX_W]; // Colors of the blocks in the glass (for drawing), size.w per line
+    tRow rows[GLASS_MAX_H];                   // Occupancy bitboard of the glass (one word per line)
+    uint8_t heights[GLASS_MAX_W];             // Column heights: lines from the bottom to the top block (0 - empty)
+    int gx, gy;                               // Glass position of the left-up block of the item (in blocks)
+    int lines;                                // Number of removed full lines
+    int items;                                // Number of items put into the glass
+    tRng rng;                                 // Random generator of the items
+    tRandomizer randomizer;                   // Way to choose the next item
+    int8_t bag[MAXITEMS];                     // Items left in the bag (RANDOM_BAG)
+    int bag_left;                             // Number of items left in the bag
+    uint32_t glass_version;                   // Changes on every change of the glass blocks (for the view caches)
+} tState;
+
+/**
+ * @brief Colors of the glass line i: the lines are packed with the glass width as stride,
+ * so the glass of any size takes only w * h bytes (moved and cleared as one block)
+ *
+ */
+#define GLASS_LINE(ST, i) ((ST)->glass + (size_t)(i) * (ST)->size.w)
+
+/**
+ * @brief Logical game clock: periods and deadlines of the game timers (in ms of game time)
+ *
+ */
+typedef struct _tgameclock
+{
+    uint32_t fall_ms;    // Period of the slow falling
+    uint32_t fast_ms;    // Period of the fast falling and of the full lines check
+    uint32_t spawn_ms;   // Delay before the next item appears
+    uint32_t now;        // Current game time
+    uint32_t next_fall;  // Deadline of the next slow falling step
+    uint32_t next_fast;  // Deadline of the next fast falling step
+    uint32_t next_spawn; // Deadline of the next item (in ITEM_STARTED)
+} tGameClock;
+
+/**
+ * @brief Auto-repeat of the held LEFT / RIGHT key (delayed auto shift, auto repeat rate),
+ * the times are in ns of a monotonic clock
+ *
+ */
+typedef struct _tautoshift
+{
+    uint64_t das_ns; // Delay from the key press to the first repeated move
+    uint64_t arr_ns; // Period of the repeated moves (0 - all the moves at once)
+    bool left;       // LEFT is held
+    bool right;      // RIGHT is held
+    tAction held;    // Repeated move (the last pressed held key), ACTION_NONE - no key is held
+    uint64_t next;   // Time of the next repeated move
+} tAutoShift;
+
+/**
+ * @brief Count set bits of the row bitmask
+ *
+ * @param x : Bitmask
+ * @return int : Number of set bits
+ */
+static inline int countBits(uint64_t x)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcountll(x);
+#else
+    int n = 0;
+    for (; x != 0; x &= x - 1)
+    {
+        n++;
+    }
+    return n;
+#endif
+}
+
+/**
+ * @brief Find the lowest set bit of the row bitmask
+ *
+ * @param x : Bitmask (not 0)
+ * @return int : Bit number
+ */
+static inline int lowestBit(uint64_t x)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(x);
+#else
+    int n = 0;
+    for (; (x & 1) == 0; x >>= 1)
+    {
+        n++;
+    }
+    return n;
+#endif
+}
+
+/**
+ * @brief Find the minimum of the 4 values
+ *
+ * @return int8_t : Minimum value
+ */
+int8_t min4(int8_t a, int8_t b, int8_t c, int8_t d);
+
+/**
+ * @brief Find the maximum of the 4 values
+ *
+ * @return int8_t : Maximum value
+ */
+int8_t max4(int8_t a, int8_t b, int8_t c, int8_t d);
+
+/**
+ * @brief Set the glass size
+ *
+ * @param G : Glass size
+ * @param w : Width in blocks (ITEMBLOCKS..GLASS_MAX_W)
+ * @param h : Height in blocks (ITEMBLOCKS..GLASS_MAX_H)
+ * @return true : Success
+ * @return false : The size is out of range, G is not changed
+ */
+bool initGlassSize(tGlassSize *G, int w, int h);
+
+/**
+ * @brief Read the glass size written as WxH (10x20)
+ *
+ * @param G : Glass size
+ * @param s : Text
+ * @return true : Success
+ * @return false : Wrong text or the size is out of range, G is not changed
+ */
+bool parseGlassSize(tGlassSize *G, const char *s);
+
+/**
+ * @brief Set the glass size of the game and clear the glass
+ *
+ * @param ST : State data structure
+ * @param w : Width in blocks
+ * @param h : Height in blocks
+ * @return true : Success
+ * @return false : The size is out of range, the state is not changed
+ */
+bool setGlassSize(tState *ST, int w, int h);
+
+/**
+ * @brief Initialize random generator
+ *
+ * @param R : Random generator
+ * @param seed : Any value, the same seed gives the same sequence
+ */
+void seedRandom(tRng *R, uint64_t seed);
+
+/**
+ * @brief Get the next random value
+ *
+ * @param R : Random generator
+ * @return uint32_t : Random value
+ */
+uint32_t getRandom(tRng *R);
+
+/**
+ * @brief Get the next random value in range [0, n)
+ *
+ * @param R : Random generator
+ * @param n : Range size
+ * @return int : Random value
+ */
+int getRandomInt(tRng *R, int n);
+
+/**
+ * @brief Seed the item generator of the game
+ *
+ * @param ST : State data structure
+ * @param seed : Seed of the item sequence
+ * @param mode : Way to choose the next item
+ */
+void initRandomizer(tState *ST, uint64_t seed, tRandomizer mode);
+
+/**
+ * @brief Choose the next item
+ *
+ * @param ST : State data structure
+ * @return int : Item id
+ */
+int getNextItem(tState *ST);
+
+/**
+ * @brief Look at the next items without taking them from the generator (preview)
+ *
+ * @param ST : State data structure
+ * @param ids : Next items in the order of getNextItem()
+ * @param n : Number of items
+ */
+void peekItems(const tState *ST, int *ids, int n);
+
+/**
+ * @brief Get the current rotation of the current item
+ *
+ * @param ST : State data structure
+ * @return const tPiece* : Item rotation data
+ */
+const tPiece *getItem(tState *ST);
+
+/**
+ * @brief Check if the item placed at the glass position overlaps walls, floor or blocks
+ *
+ * @param ST : State data structure
+ * @param gx : Glass column of the left-up block of the item
+ * @param gy : Glass line of the left-up block of the item
+ * @param rot : Item rotation
+ * @return true : The item does not fit
+ * @return false : The item fits
+ */
+bool checkItemCollision(tState *ST, int gx, int gy, int rot);
+
+/**
+ * @brief Check if the item rotation placed at the glass position overlaps walls, floor or blocks
+ *
+ * @param G : Glass size
+ * @param rows : Occupancy bitboard of the glass
+ * @param P : Item rotation
+ * @param gx : Glass column of the left-up block of the item
+ * @param gy : Glass line of the left-up block of the item
+ * @return true : The item does not fit
+ * @return false : The item fits
+ */
+bool checkPieceCollision(const tGlassSize *G, const tRow *rows, const tPiece *P, int gx, int gy);
+
+/**
+ * @brief Check the touch of the left margins of the item
+ *
+ * @param ST : State data structure
+ * @return true
+ * @return false
+ */
+bool checkItemLeft(tState *ST);
+
+/**
+ * @brief Check the touch of the right margins of the item
+ *
+ * @param ST : State data structure
+ * @return true
+ * @return false
+ */
+bool checkItemRight(tState *ST);
+
+/**
+ * @brief Check the touch of the bottom margins of the item
+ *
+ * @param ST : State data structure
+ * @return true
+ * @return false
+ */
+bool checkItemBottom(tState *ST);
+
+/**
+ * @brief Move item left by one block
+ *
+ * @param ST : State data structure
+ * @return true : The item moved
+ * @return false : The item touches the glass or blocks on the left
+ */
+bool moveItemLeft(tState *ST);
+
+/**
+ * @brief Move item right by one block
+ *
+ * @param ST : State data structure
+ * @return true : The item moved
+ * @return false : The item touches the glass or blocks on the right
+ */
+bool moveItemRight(tState *ST);
+
+/**
+ * @brief Rotate item left (the rotation is cancelled if the rotated item does not fit)
+ *
+ * @param ST : State data structure
+ * @return true : The item rotated
+ * @return false : The rotated item does not fit
+ */
+bool rotateItem(tState *ST);
+
+/**
+ * @brief Print item array values
+ *
+ * @param ST : State data structure
+ */
+void printItem(tState *ST);
+
+/**
+ * @brief Copy item's blocks to glass array (the column heights grow with them)
+ *
+ * @param ST : State data structure
+ */
+void copyBlocksToGlass(tState *ST);
+
+/**
+ * @brief Recompute the column heights from the bitboard (after the glass is changed directly)
+ *
+ * @param ST : State data structure
+ */
+void updateHeights(tState *ST);
+
+/**
+ * @brief Find the line where the item stops when it falls straight down from the position
+ *
+ * The column heights give the line in O(item width); only under an overhang (the item is
+ * below the top block of a column) the item is moved down line by line.
+ *
+ * @param ST : State data structure
+ * @param P : Item rotation
+ * @param gx, gy : Glass position of the item (no collision there)
+ * @return int : Landing line (gy of the item), not less than gy
+ */
+int getLandingRow(const tState *ST, const tPiece *P, int gx, int gy);
+
+/**
+ * @brief Print glass array values
+ *
+ * @param ST : State data structure
+ */
+void printGlass(tState *ST);
+
+/**
+ * @brief Remove specified line, all lined above move down by one line
+ *
+ * @param ST : State data structure
+ * @param line
+ */
+void removeFullLine(tState *ST, int line);
+
+/**
+ * @brief Remove all full lines touched by the stopped item in one pass (the column heights go down)
+ *
+ * @param ST : State data structure
+ * @return int : Number of removed lines
+ */
+int checkRemoveFullLine(tState *ST);
+
+/**
+ * @brief Remove all full lines of the bitboard, the lines above move down
+ *
+ * @param G : Glass size
+ * @param rows : Occupancy bitboard of the glass
+ * @return int : Number of removed lines
+ */
+int removeFullRows(const tGlassSize *G, tRow *rows);
+
+/**
+ * @brief Initialize glass array (the glass size is not changed)
+ *
+ * @param ST : State data structure
+ */
+void clearGlass(tState *ST);
+
+/**
+ * @brief Start a new game with the empty glass (of the default size if the size is not set)
+ *
+ * @param ST : State data structure
+ */
+void newGame(tState *ST);
+
+/**
+ * @brief Put a new item on the top of the glass
+ *
+ * @param ST : State data structure
+ * @param id : Item to put
+ * @return true : The item falls
+ * @return false : No room for the item, the game is finished
+ */
+bool spawnItem(tState *ST, int id);
+
+/**
+ * @brief Drop item (it falls fast till it stops)
+ *
+ * @param ST : State data structure
+ */
+void dropItem(tState *ST);
+
+/**
+ * @brief Hard drop: move the item to its landing line and stop it
+ *
+ * @param ST : State data structure
+ */
+void hardDropItem(tState *ST);
+
+/**
+ * @brief Stop item and copy its blocks to the glass
+ *
+ * @param ST : State data structure
+ */
+void lockItem(tState *ST);
+
+/**
+ * @brief Process falling step of item
+ *
+ * @param ST : State data structure
+ */
+void fallStep(tState *ST);
+
+/**
+ * @brief Set the timer periods of the game clock
+ *
+ * @param C : Game clock
+ * @param fall_ms : Period of the slow falling
+ * @param fast_ms : Period of the fast falling
+ * @param spawn_ms : Delay before the next item appears
+ */
+void initClock(tGameClock *C, uint32_t fall_ms, uint32_t fast_ms, uint32_t spawn_ms);
+
+/**
+ * @brief Start a new game at game time 0, the first item appears after the spawn delay
+ * (the randomizer must be initialized)
+ *
+ * @param ST : State data structure
+ * @param C : Game clock
+ */
+void startTimedGame(tState *ST, tGameClock *C);
+
+/**
+ * @brief Run the timers of the game till the game time (the same steps for the same times and actions)
+ *
+ * The ticks are processed in the order of their deadlines. When the game is finished the function
+ * returns right away, the next call moves it to GAME_WELCOME on the next slow falling tick.
+ *
+ * @param ST : State data structure
+ * @param C : Game clock
+ * @param now : Game time in ms, not less than the previous one
+ */
+void advanceGame(tState *ST, tGameClock *C, uint32_t now);
+
+/**
+ * @brief Get the game time of the next timer tick
+ *
+ * @param ST : State data structure
+ * @param C : Game clock
+ * @return uint32_t : Nearest deadline
+ */
+uint32_t getNextTick(const tState *ST, const tGameClock *C);
+
+/**
+ * @brief Set the auto-repeat timings, no key is held
+ *
+ * @param AS : Auto-repeat
+ * @param das_ms : Delay from the key press to the first repeated move
+ * @param arr_ms : Period of the repeated moves (0 - the item slides to the wall at once)
+ */
+void initAutoShift(tAutoShift *AS, uint32_t das_ms, uint32_t arr_ms);
+
+/**
+ * @brief LEFT / RIGHT key is pressed: its move repeats after the delay (the press itself is a player action)
+ *
+ * @param AS : Auto-repeat
+ * @param action : ACTION_LEFT or ACTION_RIGHT (other actions are ignored)
+ * @param t : Time of the key press
+ */
+void pressShift(tAutoShift *AS, tAction action, uint64_t t);
+
+/**
+ * @brief LEFT / RIGHT key is released: the other key, if it is still held, repeats after the delay
+ *
+ * @param AS : Auto-repeat
+ * @param action : ACTION_LEFT or ACTION_RIGHT (other actions are ignored)
+ * @param t : Time of the key release
+ */
+void releaseShift(tAutoShift *AS, tAction action, uint64_t t);
+
+/**
+ * @brief Take the repeated moves due till the time, AS->held is the move
+ *
+ * @param AS : Auto-repeat
+ * @param now : Current time, not less than the previous one
+ * @param max : Maximum number of moves (the glass width: more moves never change the item)
+ * @return int : Number of moves, 0..max (with ARR 0 every call after the delay returns max)
+ */
+int takeShiftRepeats(tAutoShift *AS, uint64_t now, int max);
+
+/**
+ * @brief Get the time of the next repeated move
+ *
+ * @param AS : Auto-repeat
+ * @return uint64_t : Time of the move, UINT64_MAX if no key is held
+ */
+uint64_t getNextShift(const tAutoShift *AS);
+
+/**
+ * @brief Find all final placements of the item reachable from the start position
+ *
+ * Breadth-first search over (gx, gy, rotation) with the same moves and collision rules as the game:
+ * left, right, rotate left and one line down. A placement is final when the item cannot move down.
+ * Placements giving the same blocks in the glass (symmetric rotations) are returned once.
+ *
+ * @param G : Glass size
+ * @param rows : Occupancy bitboard of the glass
+ * @param id : Item
+ * @param gx : Start glass column of the item
+ * @param gy : Start glass line of the item
+ * @param rot : Start item rotation
+ * @param out : Found placements
+ * @param max : Size of out (MAXPLACEMENTS is always enough)
+ * @return int : Number of found placements
+ */
+int findPlacements(const tGlassSize *G, const tRow *rows, int id, int gx, int gy, int rot, tPlacement *out, int max);
+
+/**
+ * @brief Find all final placements of the current item from its current position
+ *
+ * @param ST : State data structure
+ * @param out : Found placements
+ * @param max : Size of out (MAXPLACEMENTS is always enough)
+ * @return int : Number of found placements
+ */
+int getPlacements(tState *ST, tPlacement *out, int max);
+
+/**
+ * @brief Put the item blocks at the placement into the bitboard
+ *
+ * @param rows : Occupancy bitboard of the glass
+ * @param id : Item
+ * @param pl : Item placement (must fit)
+ */
+void placeItem(tRow *rows, int id, const tPlacement *pl);
+
+/**
+ * @brief Find the shortest sequence of actions moving the item from the start position to the placement
+ *
+ * ACTION_NONE stands for one line down.
+ *
+ * @param G : Glass size
+ * @param rows : Occupancy bitboard of the glass
+ * @param id : Item
+ * @param gx : Start glass column of the item
+ * @param gy : Start glass line of the item
+ * @param rot : Start item rotation
+ * @param target : Placement to reach
+ * @param path : Found actions
+ * @param max : Size of path
+ * @return int : Number of actions, -1 if the placement is not reachable
+ */
+int findPlacementPath(const tGlassSize *G, const tRow *rows, int id, int gx, int gy, int rot, const tPlacement *target,
+                      tAction *path, int max);
+
+/**
+ * @brief Apply player action to the falling item
+ *
+ * @param ST : State data structure
+ * @param action : Player action
+ * @return true : The action changed the item
+ * @return false : The action is not possible
+ */
+bool applyAction(tState *ST, tAction action);
+
+/**
+ * @brief Policy callback: choose the action for the falling item
+ *
+ * Within one falling step the policy is called again after each successful move or rotation
+ * (at most MAXMOVES(&ST->size) times), ACTION_NONE lets the item fall by one line.
+ *
+ * @param ST : State data structure
+ * @param ctx : Policy data
+ * @return tAction : Chosen action
+ */
+typedef tAction (*tPolicy)(tState *ST, void *ctx);
+
+// Maximum number of moves and rotations of the item in one falling step in the glass of size G
+#define MAXMOVES(G) ((G)->w + ITEMBLOCKS - 1 + ROTATIONS)
+
+/**
+ * @brief Play a whole game without timers (the randomizer must be initialized)
+ *
+ * @param ST : State data structure
+ * @param policy : Policy callback
+ * @param ctx : Policy data
+ * @param max_items : Stop the game after this number of items (0 - play till the game is finished)
+ */
+void playGame(tState *ST, tPolicy policy, void *ctx, int max_items);
+
+/**
+ * @brief Snapshot of the dynamic game state (plain data, no pointers)
+ *
+ * Only the occupied lines at the bottom of the glass are kept: the snapshot is followed by
+ * the column heights (SNAPSHOT_STRIDE() bytes), the bitboard rows of the lines and their
+ * block colors (as packed in tState.glass, in whole words), getSnapshotSize() bytes in all.
+ * The glass size is not a part of the snapshot, it is restored into a state of the same size.
+ * A fork (saveFork()) has the same header and column heights, then only the bitboard rows.
+ */
+typedef struct _tsnapshot
+{
+    tRng rng;             // Random generator of the items
+    int32_t lines;        // Number of removed full lines
+    int32_t items;        // Number of items put into the glass
+    int8_t bag[MAXITEMS]; // Items left in the bag
+    int8_t bag_left;      // Number of items left in the bag
+    int8_t game_state;    // GAME_STATE
+    int8_t randomizer;    // Way to choose the next item
+    int8_t item, rot;     // ITEM_ID and ROTATION
+    int8_t gx, gy;        // Glass position of the item
+    uint8_t w, h;         // Glass size (checked on restore)
+    uint8_t used;         // Occupied lines at the bottom of the glass
+} tSnapshot;
+
+// Bytes of the column heights and of the colors of a line in the snapshot: the width rounded up
+// to whole words (they are copied by words, the columns past the width stay 0)
+#if GLASS_MAX_W % 8 != 0
+#error "GLASS_MAX_W is not a multiple of 8"
+#endif
+#define SNAPSHOT_STRIDE(w) (((w) + 7) & ~7)
+
+// Largest snapshot with the lines (the glass of GLASS_MAX_W x GLASS_MAX_H full up to the top)
+#define SNAPSHOT_MAX_SIZE (sizeof(tSnapshot) + GLASS_MAX_W + GLASS_MAX_H * (sizeof(tRow) + GLASS_MAX_W))
+
+/**
+ * @brief Get the size of the snapshot of the state
+ *
+ * @param ST : State data structure
+ * @return size_t : Snapshot size in bytes (the header and the occupied lines)
+ */
+size_t getSnapshotSize(const tState *ST);
+
+/**
+ * @brief Save the dynamic game state
+ *
+ * @param ST : State data structure
+ * @param buf : Snapshot memory, getSnapshotSize() bytes aligned to 8
+ * @return size_t : Snapshot size in bytes
+ */
+size_t saveSnapshot(const tState *ST, void *buf);
+
+/**
+ * @brief Restore the saved game state (the lines above the saved ones are cleared)
+ *
+ * @param ST : State data structure of the same glass size with consistent column heights
+ * @param buf : Snapshot made by saveSnapshot()
+ * @return true : The state is restored
+ * @return false : The snapshot is of another glass size (or it is broken), the state is not changed
+ */
+bool restoreSnapshot(tState *ST, const void *buf);
+
+// Bytes of a bitboard row in the fork: the smallest word holding the glass width
+#define FORK_ROW_BYTES(w) ((w) <= 8 ? 1 : (w) <= 16 ? 2 : (w) <= 32 ? 4 : 8)
+
+// Largest fork (the glass of GLASS_MAX_W x GLASS_MAX_H full up to the top)
+#define FORK_MAX_SIZE (sizeof(tSnapshot) + GLASS_MAX_W + GLASS_MAX_H * FORK_ROW_BYTES(GLASS_MAX_W))
+
+/**
+ * @brief Get the size of the fork of the state
+ *
+ * @param ST : State data structure
+ * @return size_t : Fork size in bytes (a multiple of 8)
+ */
+size_t getForkSize(const tState *ST);
+
+/**
+ * @brief Save the game state for the search: the snapshot header, the column heights and the
+ * bitboard rows of the occupied lines (FORK_ROW_BYTES() each), without the block colors
+ *
+ * @param ST : State data structure
+ * @param buf : Fork memory, getForkSize() bytes aligned to 8
+ * @return size_t : Fork size in bytes
+ */
+size_t saveFork(const tState *ST, void *buf);
+
+/**
+ * @brief Restore the game state saved by saveFork() (the bitboard lines above the saved ones are cleared)
+ *
+ * The block colors are not restored: they are stale until newGame(), the state is for the
+ * search only (it is not drawn, saved by saveSnapshot() or hashed by the replay).
+ *
+ * @param ST : State data structure of the same glass size with consistent column heights
+ * @param buf : Fork made by saveFork()
+ * @return true : The state is restored
+ * @return false : The fork is of another glass size (or it is broken), the state is not changed
+ */
+bool restoreFork(tState *ST, const void *buf);
+
+/**
+ * @brief Undo stack: snapshots one after another in an arena
+ *
+ */
+typedef struct _tundostack
+{
+    tArena arena; // Snapshots, each one after the offset of the previous one
+    size_t top;   // Offset of the last snapshot record
+    int count;    // Number of snapshots
+} tUndoStack;
+
+/**
+ * @brief Allocate the undo stack
+ *
+ * @param U : Undo stack
+ * @param size : Arena size in bytes (a typical 14x28 snapshot takes 100-300 bytes)
+ * @return true : The stack is ready
+ * @return false : Out of memory
+ */
+bool initUndo(tUndoStack *U, size_t size);
+
+/**
+ * @brief Release the undo stack
+ *
+ * @param U : Undo stack
+ */
+void freeUndo(tUndoStack *U);
+
+/**
+ * @brief Drop all snapshots
+ *
+ * @param U : Undo stack
+ */
+void clearUndo(tUndoStack *U);
+
+/**
+ * @brief Push the snapshot of the state
+ *
+ * @param U : Undo stack
+ * @param ST : State data structure
+ * @return true : The snapshot is pushed
+ * @return false : The arena is full
+ */
+bool pushUndo(tUndoStack *U, const tState *ST);
+
+/**
+ * @brief Restore the last pushed state and drop its snapshot
+ *
+ * @param U : Undo stack
+ * @param ST : State data structure
+ * @return true : The state is restored
+ * @return false : The stack is empty (or the snapshot is of another glass size)
+ */
+bool popUndo(tUndoStack *U, tState *ST);
+
+#endif // TETRIS_CORE_H
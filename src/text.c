@@ -0,0 +1,214 @@
+#include "text.h"
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * @brief Find the opened font of the size
+ *
+ * @param TC : Text cache
+ * @param size : Font size
+ * @return TTF_Font* : Font, NULL if it is not opened
+ */
+static TTF_Font* getFont(tTextCache* TC, int size)
+{
+    for (int i = 0; i < TC->n_fonts; i++)
+    {
+        if (TC->sizes[i] == size)
+        {
+            return TC->fonts[i];
+        }
+    }
+    return NULL;
+}
+
+bool initTextCache(tTextCache* TC, SDL_Renderer* rend, const char* font, const int* sizes, int n)
+{
+    const char* dirs[] = {"", "src/", "../src/"};
+    char path[256];
+
+    memset(TC, 0, sizeof(*TC));
+    TC->rend = rend;
+    for (int d = 0; d < 3 && TC->n_fonts == 0; d++)
+    {
+        snprintf(path, sizeof(path), "%s%s", dirs[d], font);
+        for (int i = 0; i < n && i < TEXT_MAXFONTS; i++)
+        {
+            TC->fonts[i] = TTF_OpenFont(path, sizes[i]);
+            if (!TC->fonts[i])
+            {
+                // not in this directory
+                for (int k = 0; k < i; k++)
+                {
+                    TTF_CloseFont(TC->fonts[k]);
+                }
+                TC->n_fonts = 0;
+                break;
+            }
+            TC->sizes[i] = sizes[i];
+            TC->n_fonts = i + 1;
+        }
+    }
+    return TC->n_fonts > 0;
+}
+
+void freeTextCache(tTextCache* TC)
+{
+    for (int i = 0; i < TC->n_entries; i++)
+    {
+        SDL_DestroyTexture(TC->entries[i].texture);
+    }
+    if (TC->atlas.texture)
+    {
+        SDL_DestroyTexture(TC->atlas.texture);
+    }
+    for (int i = 0; i < TC->n_fonts; i++)
+    {
+        TTF_CloseFont(TC->fonts[i]);
+    }
+    memset(TC, 0, sizeof(*TC));
+}
+
+bool reloadTextCache(tTextCache* TC)
+{
+    // the dead textures are only destroyed, the strings are rendered again when drawn
+    for (int i = 0; i < TC->n_entries; i++)
+    {
+        SDL_DestroyTexture(TC->entries[i].texture);
+    }
+    TC->n_entries = 0;
+    if (TC->atlas.texture)
+    {
+        SDL_DestroyTexture(TC->atlas.texture);
+        TC->atlas.texture = NULL;
+    }
+    return TC->atlas.size == 0 || buildGlyphAtlas(TC, TC->atlas.size);
+}
+
+const tTextEntry* getText(tTextCache* TC, const char* text, int size)
+{
+    for (int i = 0; i < TC->n_entries; i++)
+    {
+        if (TC->entries[i].size == size && strcmp(TC->entries[i].text, text) == 0)
+        {
+            return &TC->entries[i];
+        }
+    }
+
+    TTF_Font* font = getFont(TC, size);
+    if (!font || TC->n_entries == TEXT_MAXENTRIES || strlen(text) >= TEXT_MAXLEN)
+    {
+        return NULL;
+    }
+    SDL_Color color = {255, 255, 255, 255};
+    SDL_Surface* surface = TTF_RenderText_Solid(font, text, color);
+    if (!surface)
+    {
+        return NULL;
+    }
+    tTextEntry* E = &TC->entries[TC->n_entries];
+    E->texture = SDL_CreateTextureFromSurface(TC->rend, surface);
+    SDL_FreeSurface(surface);
+    if (!E->texture)
+    {
+        return NULL;
+    }
+    strcpy(E->text, text);
+    E->size = size;
+    SDL_QueryTexture(E->texture, NULL, NULL, &E->w, &E->h);
+    TC->n_entries++;
+    return E;
+}
+
+void drawTextCentered(tTextCache* TC, const char* text, int size, int cx, int y)
+{
+    const tTextEntry* E = getText(TC, text, size);
+    if (E)
+    {
+        SDL_Rect rect = {cx - E->w / 2, y, E->w, E->h};
+        SDL_RenderCopy(TC->rend, E->texture, NULL, &rect);
+    }
+}
+
+bool buildGlyphAtlas(tTextCache* TC, int size)
+{
+    TTF_Font* font = getFont(TC, size);
+    if (!font)
+    {
+        return false;
+    }
+    SDL_Color color = {255, 255, 255, 255};
+    SDL_Surface* glyphs[ATLAS_GLYPHS];
+    int w = 0, h = 0;
+
+    // render the glyphs one by one, then put them side by side into one surface
+    for (int c = 0; c < ATLAS_GLYPHS; c++)
+    {
+        int advance = 0;
+        TTF_GlyphMetrics(font, (Uint16)(ATLAS_FIRST + c), NULL, NULL, NULL, NULL, &advance);
+        TC->atlas.advance[c] = advance;
+        glyphs[c] = TTF_RenderGlyph_Blended(font, (Uint16)(ATLAS_FIRST + c), color);
+        if (glyphs[c])
+        {
+            w += glyphs[c]->w;
+            h = glyphs[c]->h > h ? glyphs[c]->h : h;
+        }
+    }
+
+    bool ok = false;
+    SDL_Surface* atlas = w > 0 ? SDL_CreateRGBSurfaceWithFormat(0, w, h, 32, SDL_PIXELFORMAT_RGBA32) : NULL;
+    if (atlas)
+    {
+        int x = 0;
+        for (int c = 0; c < ATLAS_GLYPHS; c++)
+        {
+            SDL_Rect rect = {x, 0, glyphs[c] ? glyphs[c]->w : 0, glyphs[c] ? glyphs[c]->h : 0};
+            if (glyphs[c])
+            {
+                // copy the alpha of the glyph as is
+                SDL_SetSurfaceBlendMode(glyphs[c], SDL_BLENDMODE_NONE);
+                SDL_BlitSurface(glyphs[c], NULL, atlas, &rect);
+            }
+            TC->atlas.glyphs[c] = rect;
+            x += rect.w;
+        }
+        if (TC->atlas.texture)
+        {
+            SDL_DestroyTexture(TC->atlas.texture);
+        }
+        TC->atlas.texture = SDL_CreateTextureFromSurface(TC->rend, atlas);
+        if (TC->atlas.texture)
+        {
+            SDL_SetTextureBlendMode(TC->atlas.texture, SDL_BLENDMODE_BLEND);
+            TC->atlas.size = size;
+            ok = true;
+        }
+        SDL_FreeSurface(atlas);
+    }
+    for (int c = 0; c < ATLAS_GLYPHS; c++)
+    {
+        if (glyphs[c])
+        {
+            SDL_FreeSurface(glyphs[c]);
+        }
+    }
+    return ok;
+}
+
+void drawAtlasText(tTextCache* TC, const char* text, int x, int y)
+{
+    if (!TC->atlas.texture)
+    {
+        return;
+    }
+    for (const char* c = text; *c; c++)
+    {
+        if (*c < ATLAS_FIRST || *c > ATLAS_LAST)
+        {
+            continue;
+        }
+        const SDL_Rect* src = &TC->atlas.glyphs[*c - ATLAS_FIRST];
+        SDL_Rect dst = {x, y, src->w, src->h};
+        SDL_RenderCopy(TC->rend, TC->atlas.texture, src, &dst);
+        x += TC->atlas.advance[*c - ATLAS_FIRST];
+    }
+}
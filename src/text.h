@@ -0,0 +1,126 @@
+#ifndef TEXT_H
+#define TEXT_H
+
+// Text cache: fonts are opened once, static strings are rendered to textures once,
+// changing text (scores) is drawn from a glyph atlas
+
+#include <SDL.h>
+#include <SDL_ttf.h>
+#include <stdbool.h>
+
+#define TEXT_MAXFONTS 4     // Maximum number of font sizes
+#define TEXT_MAXENTRIES 32  // Maximum number of cached strings
+#define TEXT_MAXLEN 64      // Maximum length of a cached string
+#define ATLAS_FIRST ' '     // First glyph of the atlas
+#define ATLAS_LAST '~'      // Last glyph of the atlas
+#define ATLAS_GLYPHS (ATLAS_LAST - ATLAS_FIRST + 1)
+
+/**
+ * @brief Cached string texture
+ *
+ */
+typedef struct _ttextentry
+{
+    char text[TEXT_MAXLEN]; // String
+    int size;               // Font size
+    SDL_Texture *texture;   // Rendered string
+    int w, h;               // Texture size in px
+} tTextEntry;
+
+/**
+ * @brief Glyph atlas: all printable ASCII glyphs of one font size in one texture
+ *
+ */
+typedef struct _tglyphatlas
+{
+    SDL_Texture *texture;         // Glyphs side by side
+    SDL_Rect glyphs[ATLAS_GLYPHS]; // Glyph rectangles in the texture
+    int advance[ATLAS_GLYPHS];    // Horizontal advance of every glyph
+    int size;                     // Font size (0 - no atlas)
+} tGlyphAtlas;
+
+/**
+ * @brief Text cache data structure
+ *
+ */
+typedef struct _ttextcache
+{
+    SDL_Renderer *rend;                   // Renderer of the textures
+    TTF_Font *fonts[TEXT_MAXFONTS];       // Opened fonts
+    int sizes[TEXT_MAXFONTS];             // Their sizes
+    int n_fonts;                          // Number of opened fonts
+    tTextEntry entries[TEXT_MAXENTRIES];  // Cached strings
+    int n_entries;                        // Number of cached strings
+    tGlyphAtlas atlas;                    // Atlas for the changing text
+} tTextCache;
+
+/**
+ * @brief Open the font in all sizes (the font file is looked up in the current, src/ and ../src/ directories)
+ *
+ * @param TC : Text cache
+ * @param rend : Renderer data structure
+ * @param font : Font file name
+ * @param sizes : Font sizes
+ * @param n : Number of sizes
+ * @return true : Fonts are opened
+ * @return false : The font is not found (text is not drawn, the game works without it)
+ */
+bool initTextCache(tTextCache *TC, SDL_Renderer *rend, const char *font, const int *sizes, int n);
+
+/**
+ * @brief Close the fonts and destroy the cached textures
+ *
+ * @param TC : Text cache
+ */
+void freeTextCache(tTextCache *TC);
+
+/**
+ * @brief Render the textures again after the renderer lost them (the fonts stay open)
+ *
+ * @param TC : Text cache
+ * @return true : The glyph atlas is rebuilt (or there was none)
+ * @return false : The atlas can not be rebuilt
+ */
+bool reloadTextCache(tTextCache *TC);
+
+/**
+ * @brief Get the string texture, render it on the first use
+ *
+ * @param TC : Text cache
+ * @param text : String
+ * @param size : Font size (one of initTextCache() sizes)
+ * @return const tTextEntry* : Cached texture, NULL if the text can not be rendered
+ */
+const tTextEntry *getText(tTextCache *TC, const char *text, int size);
+
+/**
+ * @brief Draw the string centered horizontally
+ *
+ * @param TC : Text cache
+ * @param text : String
+ * @param size : Font size
+ * @param cx : Center of the string in px
+ * @param y : Top of the string in px
+ */
+void drawTextCentered(tTextCache *TC, const char *text, int size, int cx, int y);
+
+/**
+ * @brief Render printable ASCII glyphs of the font size to the atlas
+ *
+ * @param TC : Text cache
+ * @param size : Font size (one of initTextCache() sizes)
+ * @return true : Success
+ * @return false : No such font or out of memory
+ */
+bool buildGlyphAtlas(tTextCache *TC, int size);
+
+/**
+ * @brief Draw changing text glyph by glyph from the atlas (nothing is rendered by the font)
+ *
+ * @param TC : Text cache
+ * @param text : String
+ * @param x, y : Left top corner of the string in px
+ */
+void drawAtlasText(tTextCache *TC, const char *text, int x, int y);
+
+#endif // TEXT_H
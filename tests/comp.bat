@@ -1,2 +1 @@
-gcc tests.c ..\src\tetris.c -I..\src -IC:/DEVSOFT/SDL2/include -LC:/DEVSOFT/SDL2/lib -lmingw32 -lSDL2main -lSDL2 -o tests
-
+gcc tests.c ..\src\tetris_core.c ..\src\pieces.c ..\src\eval.c ..\src\ai.c ..\src\replay.c ..\src\policy.c ..\src\arena.c ..\src\prof.c -I..\src -o tests
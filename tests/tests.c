@@ -1,5 +1,11 @@
-#include "tetris.h"
 #include "minunit.h"
+#include "tetris_core.h"
+#include "eval.h"
+#include "ai.h"
+#include "replay.h"
+#include "policy.h"
+#include "prof.h"
+#include <stdlib.h>
 
 MU_TEST(test_min4_01) {
 	mu_check(min4(-7,4,5,2) == -7);
@@ -27,6 +33,586 @@ MU_TEST(test_max4_04) {
 	mu_check(max4(1,-2,0,15) == 15);
 }
 
+static tState ST;
+
+static void setup_item_O(void) {
+	memset(&ST, 0, sizeof(ST));
+	initGlassSize(&ST.size, GLASS_W, GLASS_H);
+	ST.ITEM_ID = 1;
+}
+
+static void setup_item_I(void) {
+	memset(&ST, 0, sizeof(ST));
+	initGlassSize(&ST.size, GLASS_W, GLASS_H);
+	ST.ITEM_ID = 0;
+}
+
+MU_TEST(test_collision_walls) {
+	mu_check(!checkItemCollision(&ST, -1, 0, 0));
+	mu_check(checkItemCollision(&ST, -2, 0, 0));
+	mu_check(!checkItemCollision(&ST, GLASS_W - 3, 0, 0));
+	mu_check(checkItemCollision(&ST, GLASS_W - 2, 0, 0));
+	mu_check(!checkItemCollision(&ST, 0, GLASS_H - 3, 0));
+	mu_check(checkItemCollision(&ST, 0, GLASS_H - 2, 0));
+	mu_check(checkItemCollision(&ST, 0, -2, 0));
+}
+MU_TEST(test_collision_blocks) {
+	GLASS_LINE(&ST, GLASS_H - 1)[5] = 3;
+	ST.rows[GLASS_H - 1] = 1 << 5;
+	ST.gx = 4;
+	ST.gy = GLASS_H - 4;
+	mu_check(!checkItemCollision(&ST, ST.gx, ST.gy, 0));
+	mu_check(checkItemBottom(&ST));
+	ST.gx = 6;
+	mu_check(!checkItemBottom(&ST));
+	ST.gx = 5;
+	ST.gy = GLASS_H - 3;
+	mu_check(checkItemLeft(&ST));
+	mu_check(!checkItemRight(&ST));
+}
+MU_TEST(test_copy_blocks) {
+	ST.gx = 2;
+	ST.gy = GLASS_H - 3;
+	copyBlocksToGlass(&ST);
+	mu_check(ST.glass_version == 1);
+	mu_check(ST.rows[GLASS_H - 2] == (3 << 3));
+	mu_check(ST.rows[GLASS_H - 1] == (3 << 3));
+	mu_check(GLASS_LINE(&ST, GLASS_H - 1)[3] == 2 && GLASS_LINE(&ST, GLASS_H - 1)[4] == 2);
+	mu_check(checkItemCollision(&ST, ST.gx, ST.gy, 0));
+	// no full lines: the glass is not changed
+	mu_assert_int_eq(0, checkRemoveFullLine(&ST));
+	mu_check(ST.glass_version == 1);
+	clearGlass(&ST);
+	mu_check(ST.glass_version == 2);
+}
+
+MU_TEST(test_pieces_table) {
+	for (int id = 0; id < MAXITEMS; id++) {
+		for (int r = 0; r < ROTATIONS; r++) {
+			const tPiece *P = &PIECES[id][r];
+			int blocks = 0, bits = 0;
+			for (int i = 0; i < ITEMBLOCKS * ITEMBLOCKS; i++) {
+				blocks += P->blocks[i] > 0;
+			}
+			for (int i = 0; i < ITEMBLOCKS; i++) {
+				for (int j = 0; j < ITEMBLOCKS; j++) {
+					bits += (P->rows[i] >> j) & 1;
+				}
+			}
+			mu_check(blocks == ITEMBLOCKS);
+			mu_check(bits == ITEMBLOCKS);
+			mu_check(P->rows[P->top] != 0 && P->rows[P->bottom] != 0);
+		}
+	}
+}
+MU_TEST(test_rotate_item) {
+	ST.gx = 5;
+	ST.gy = 5;
+	rotateItem(&ST);
+	mu_check(ST.ROTATION == 1);
+	mu_check(getItem(&ST)->rows[2] == 15);
+	rotateItem(&ST);
+	rotateItem(&ST);
+	rotateItem(&ST);
+	mu_check(ST.ROTATION == 0);
+	// no room for the horizontal item at the left wall
+	ST.gx = -1;
+	rotateItem(&ST);
+	mu_check(ST.ROTATION == 0);
+}
+MU_TEST(test_remove_full_lines) {
+	// 3 lines full except column 0, one block on top of them
+	for (int i = GLASS_H - 3; i < GLASS_H; i++) {
+		for (int j = 1; j < GLASS_W; j++) {
+			GLASS_LINE(&ST, i)[j] = 2;
+		}
+		ST.rows[i] = ST.size.full & ~1;
+	}
+	ST.rows[GLASS_H - 2] &= ~2;
+	GLASS_LINE(&ST, GLASS_H - 2)[1] = 0;
+	GLASS_LINE(&ST, GLASS_H - 4)[5] = 3;
+	ST.rows[GLASS_H - 4] = 1 << 5;
+	updateHeights(&ST);
+	mu_check(ST.heights[0] == 0 && ST.heights[1] == 3 && ST.heights[5] == 4);
+	// vertical item dropped into column 0
+	ST.gx = -1;
+	ST.gy = GLASS_H - 4;
+	copyBlocksToGlass(&ST);
+	mu_check(ST.heights[0] == 4);
+	mu_assert_int_eq(2, checkRemoveFullLine(&ST));
+	// the top of column 1 was in a removed line, the hole under it is its new top
+	mu_check(ST.heights[0] == 2 && ST.heights[1] == 0 && ST.heights[2] == 1 && ST.heights[5] == 2);
+	mu_assert_int_eq(2, ST.lines);
+	mu_check(ST.rows[GLASS_H - 1] == (ST.size.full & ~2));
+	mu_check(ST.rows[GLASS_H - 2] == ((1 << 5) | 1));
+	mu_check(GLASS_LINE(&ST, GLASS_H - 2)[5] == 3 && GLASS_LINE(&ST, GLASS_H - 2)[0] == 1);
+	mu_check(ST.rows[GLASS_H - 3] == 0 && ST.rows[0] == 0);
+	mu_assert_int_eq(0, checkRemoveFullLine(&ST));
+}
+MU_TEST(test_random_seed) {
+	tRng a, b;
+	seedRandom(&a, 42);
+	seedRandom(&b, 42);
+	for (int i = 0; i < 100; i++) {
+		mu_check(getRandom(&a) == getRandom(&b));
+	}
+	seedRandom(&b, 43);
+	mu_check(getRandom(&a) != getRandom(&b));
+	for (int i = 0; i < 1000; i++) {
+		int r = getRandomInt(&a, MAXITEMS);
+		mu_check(r >= 0 && r < MAXITEMS);
+	}
+}
+MU_TEST(test_random_bag) {
+	initRandomizer(&ST, 7, RANDOM_BAG);
+	for (int n = 0; n < 10; n++) {
+		int seen = 0;
+		for (int i = 0; i < MAXITEMS; i++) {
+			seen |= 1 << getNextItem(&ST);
+		}
+		mu_check(seen == (1 << MAXITEMS) - 1);
+	}
+}
+MU_TEST(test_placements_empty) {
+	tRow rows[GLASS_MAX_H] = {0};
+	static tPlacement out[MAXPLACEMENTS];
+	// the default glass, the standard one and the widest one
+	const int sizes[3][2] = {{GLASS_W, GLASS_H}, {10, 20}, {GLASS_MAX_W, GLASS_MAX_H}};
+	for (int s = 0; s < 3; s++) {
+		tGlassSize G;
+		mu_check(initGlassSize(&G, sizes[s][0], sizes[s][1]));
+		int w = G.w, gx = (w - ITEMBLOCKS) / 2;
+		// O: one rotation, I: two, T: four
+		mu_assert_int_eq(w - 1, findPlacements(&G, rows, 1, gx, 0, 0, out, MAXPLACEMENTS));
+		mu_assert_int_eq(w + w - 3, findPlacements(&G, rows, 0, gx, 0, 0, out, MAXPLACEMENTS));
+		mu_assert_int_eq(2 * (w - 2) + 2 * (w - 1), findPlacements(&G, rows, 6, gx, 0, 0, out, MAXPLACEMENTS));
+		for (int i = 0; i < 2 * (w - 2) + 2 * (w - 1); i++) {
+			mu_check(out[i].gy + PIECES[6][out[i].rot].bottom == G.h - 1);
+		}
+	}
+}
+MU_TEST(test_placements_tuck) {
+	tPlacement out[MAXPLACEMENTS];
+	tAction path[64];
+	// overhang over columns 0-2, the O item can only slide under it
+	ST.rows[GLASS_H - 3] = 7;
+	ST.gx = 5;
+	int n = getPlacements(&ST, out, MAXPLACEMENTS);
+	int k = -1;
+	for (int i = 0; i < n; i++) {
+		if (out[i].gx + 1 == 0 && out[i].gy + 1 == GLASS_H - 2) {
+			k = i;
+		}
+	}
+	mu_check(k >= 0);
+	int len = findPlacementPath(&ST.size, ST.rows, ST.ITEM_ID, ST.gx, ST.gy, ST.ROTATION, &out[k], path, 64);
+	mu_check(len > 0);
+	for (int i = 0; i < len; i++) {
+		if (path[i] == ACTION_NONE) {
+			mu_check(!checkItemBottom(&ST));
+			ST.gy++;
+		} else {
+			mu_check(applyAction(&ST, path[i]));
+		}
+	}
+	mu_check(ST.gx == out[k].gx && ST.gy == out[k].gy && ST.ROTATION == out[k].rot);
+	mu_check(checkItemBottom(&ST));
+}
+MU_TEST(test_eval_board) {
+	tRow rows[GLASS_H] = {0};
+	tFeatures F;
+	// one full line, column 0 of height 2 with a hole, column 2 of height 1
+	rows[GLASS_H - 1] = ST.size.full;
+	rows[GLASS_H - 3] = 1;
+	rows[GLASS_H - 2] = 4;
+	evalBoards(&ST.size, rows, 1, &F);
+	mu_assert_int_eq(1, F.lines);
+	mu_assert_int_eq(3, F.height);
+	mu_assert_int_eq(1, F.holes);
+	mu_assert_int_eq(2 + 1 + 1, F.bumpiness);
+	mu_assert_int_eq(1, F.wells);
+}
+MU_TEST(test_eval_random) {
+	static tRow boards[32][GLASS_MAX_H];
+	tFeatures F[32];
+	tRng rng;
+	seedRandom(&rng, 5);
+	// the kernels of the common sizes and the one of any size give the same features
+	const int sizes[4][2] = {{GLASS_W, GLASS_H}, {10, 20}, {13, 21}, {GLASS_MAX_W, GLASS_MAX_H}};
+	for (int s = 0; s < 4; s++) {
+		tGlassSize G;
+		mu_check(initGlassSize(&G, sizes[s][0], sizes[s][1]));
+		int W = G.w, H = G.h;
+		tRow *flat = &boards[0][0];
+		for (int b = 0; b < 32; b++) {
+			for (int i = 0; i < H; i++) {
+				int r = getRandomInt(&rng, 4);
+				uint64_t bits = (uint64_t)getRandom(&rng) << 32 | getRandom(&rng);
+				flat[b * H + i] = i < H / 2 ? 0 : r == 0 ? G.full : (tRow)(bits & G.full);
+			}
+		}
+		evalBoards(&G, flat, 32, F);
+		for (int b = 0; b < 32; b++) {
+			// naive version: remove the full lines, then look at every cell
+			const tRow *board = flat + b * H;
+			tRow rows[GLASS_MAX_H] = {0};
+			int n = H, lines = 0, h[GLASS_MAX_W + 2];
+			for (int i = H - 1; i >= 0; i--) {
+				if (board[i] == G.full) {
+					lines++;
+				} else {
+					rows[--n] = board[i];
+				}
+			}
+			int height = 0, holes = 0, bump = 0, wells = 0;
+			h[0] = h[W + 1] = H * 2;
+			for (int j = 0; j < W; j++) {
+				h[j + 1] = 0;
+				for (int i = 0; i < H; i++) {
+					if (rows[i] >> j & 1) {
+						if (h[j + 1] == 0) {
+							h[j + 1] = H - i;
+						}
+					} else if (h[j + 1] > 0) {
+						holes++;
+					}
+				}
+				height += h[j + 1];
+			}
+			for (int j = 1; j <= W; j++) {
+				if (j < W) {
+					bump += h[j] > h[j + 1] ? h[j] - h[j + 1] : h[j + 1] - h[j];
+				}
+				int side = h[j - 1] < h[j + 1] ? h[j - 1] : h[j + 1];
+				wells += side > h[j] ? side - h[j] : 0;
+			}
+			mu_assert_int_eq(lines, F[b].lines);
+			mu_assert_int_eq(height, F[b].height);
+			mu_assert_int_eq(holes, F[b].holes);
+			mu_assert_int_eq(bump, F[b].bumpiness);
+			mu_assert_int_eq(wells, F[b].wells);
+		}
+	}
+}
+MU_TEST(test_remove_full_rows) {
+	tRow rows[GLASS_H] = {0};
+	rows[GLASS_H - 1] = ST.size.full;
+	rows[GLASS_H - 2] = 5;
+	rows[GLASS_H - 3] = ST.size.full;
+	rows[GLASS_H - 4] = 2;
+	mu_assert_int_eq(2, removeFullRows(&ST.size, rows));
+	mu_check(rows[GLASS_H - 1] == 5 && rows[GLASS_H - 2] == 2);
+	mu_check(rows[GLASS_H - 3] == 0 && rows[GLASS_H - 4] == 0);
+}
+MU_TEST(test_ai_play) {
+	static tAI AI;
+	mu_check(initAI(&AI, &ST.size, 2, 8, 12));
+	initRandomizer(&ST, 3, RANDOM_BAG);
+	playGame(&ST, policyAI, &AI, 200);
+	mu_assert_int_eq(200, ST.items);
+	mu_check(ST.GAME_STATE != GAME_FINISHED);
+	mu_check(ST.lines >= 40);
+	// different move orders lead to the same boards
+	mu_check(AI.merged > 0);
+	// every search starts from the empty arena, the block sized at start is never outgrown
+	mu_check(AI.arena_peak > 0 && AI.arena_peak <= AI.arena.size);
+	mu_check(AI.arena.used <= AI.arena_peak);
+	freeAI(&AI);
+}
+MU_TEST(test_glass_size) {
+	static tAI AI;
+	tGlassSize G;
+	mu_check(!initGlassSize(&G, ITEMBLOCKS - 1, 20) && !initGlassSize(&G, GLASS_MAX_W + 1, 20));
+	mu_check(!parseGlassSize(&G, "10x") && !parseGlassSize(&G, "10x20x") && !parseGlassSize(&G, "10 20"));
+	mu_check(parseGlassSize(&G, "10x20") && G.w == 10 && G.h == 20 && G.full == 0x3ff);
+	// the standard glass: the item appears in the middle, the bot clears lines in it
+	mu_check(setGlassSize(&ST, G.w, G.h));
+	mu_check(initAI(&AI, &ST.size, 2, 8, 12));
+	initRandomizer(&ST, 3, RANDOM_BAG);
+	playGame(&ST, policyAI, &AI, 100);
+	mu_assert_int_eq(100, ST.items);
+	mu_check(ST.GAME_STATE != GAME_FINISHED);
+	mu_check(ST.lines >= 30);
+	for (int i = 0; i < GLASS_MAX_H; i++) {
+		mu_check((ST.rows[i] & ~G.full) == 0 && (i < G.h || ST.rows[i] == 0));
+	}
+	freeAI(&AI);
+	// the bot does not play in a glass of another size
+	mu_check(setGlassSize(&ST, GLASS_W, GLASS_H));
+	mu_check(initAI(&AI, &G, 1, 1, 4));
+	spawnItem(&ST, 0);
+	tPlacement best;
+	mu_check(!searchPlacement(&AI, &ST, &best));
+	freeAI(&AI);
+}
+
+static void countStops(const tState *S, uint32_t ms, void *ctx) {
+	(void)S;
+	(void)ms;
+	(*(int *)ctx)++;
+}
+
+MU_TEST(test_replay) {
+	tReplay R;
+	tReplayHeader H = {.glass_w = GLASS_W,
+			   .glass_h = GLASS_H,
+			   .randomizer = RANDOM_BAG,
+			   .seed = 11,
+			   .fall_ms = 1000,
+			   .fast_ms = 75,
+			   .spawn_ms = 500};
+	tGameClock C;
+	tRng moves;
+	uint32_t now = 0;
+	int n = 0;
+	mu_check(startReplay(&R, &H));
+	initRandomizer(&ST, H.seed, RANDOM_BAG);
+	initClock(&C, H.fall_ms, H.fast_ms, H.spawn_ms);
+	startTimedGame(&ST, &C);
+	seedRandom(&moves, 5);
+	// the game loop: the timers run, then the player acts
+	while (ST.GAME_STATE != GAME_FINISHED && now < 600000) {
+		now += 1 + getRandomInt(&moves, 40);
+		advanceGame(&ST, &C, now);
+		if (ST.GAME_STATE == ITEM_FALLING && getRandomInt(&moves, 4) == 0) {
+			tAction action = (tAction)(1 + getRandomInt(&moves, 4));
+			applyAction(&ST, action);
+			mu_check(recordAction(&R, C.now, action));
+			n++;
+		}
+	}
+	mu_check(ST.GAME_STATE == GAME_FINISHED);
+	mu_check(finishReplay(&R, C.now, &ST));
+	// a few bytes per action
+	mu_check(R.size < REPLAY_HEADER_SIZE + REPLAY_FOOTER_SIZE + 3 * (size_t)n + 1);
+
+	tState P;
+	tReplayResult res = playReplay(R.data, R.size, &P, NULL, NULL);
+	mu_check(res.valid && res.verified && res.finished);
+	mu_assert_int_eq(n, res.actions);
+	mu_assert_int_eq(ST.items, P.items);
+	mu_check(res.time == C.now);
+	// the observer sees every stopped item, the game is the same
+	int stops = 0;
+	res = playReplay(R.data, R.size, &P, countStops, &stops);
+	mu_check(res.valid && res.verified);
+	mu_assert_int_eq(ST.items, stops);
+	// the size is found in a pack of two replays
+	uint8_t *pack = malloc(2 * R.size);
+	memcpy(pack, R.data, R.size);
+	memcpy(pack + R.size, R.data, R.size);
+	mu_check(getReplaySize(pack, 2 * R.size) == R.size);
+	mu_check(getReplaySize(pack + R.size, R.size) == R.size);
+	mu_check(getReplaySize(pack, R.size - 1) == 0);
+	free(pack);
+	// a changed footer does not match the final glass
+	R.data[R.size - 9] ^= 1;
+	res = playReplay(R.data, R.size, &P, NULL, NULL);
+	mu_check(res.valid && !res.verified);
+	R.data[R.size - 9] ^= 1;
+	// neither does a changed action: the first record (action in the low 3 bits) plays another move
+	uint8_t *rec = R.data + REPLAY_HEADER_SIZE;
+	*rec = (uint8_t)((*rec & ~7) | ((*rec & 7) % 4 + 1));
+	res = playReplay(R.data, R.size, &P, NULL, NULL);
+	mu_check(res.valid && !res.verified);
+	mu_assert_int_eq(n, res.actions);
+	freeReplay(&R);
+}
+
+MU_TEST(test_landing_row) {
+	tRng moves;
+	uint8_t heights[GLASS_MAX_W];
+	memset(&ST, 0, sizeof(ST));
+	initGlassSize(&ST.size, GLASS_W, GLASS_H);
+	initRandomizer(&ST, 3, RANDOM_UNIFORM);
+	seedRandom(&moves, 4);
+	// random games: the kept heights match the glass, the landing line matches the line by line fall
+	for (int game = 0; game < 20; game++) {
+		newGame(&ST);
+		while (spawnItem(&ST, getNextItem(&ST))) {
+			for (int k = 0; k < 8 && ST.GAME_STATE == ITEM_FALLING; k++) {
+				applyAction(&ST, policyRandom(&ST, &moves));
+			}
+			for (int rot = 0; rot < ROTATIONS; rot++) {
+				const tPiece *P = &PIECES[ST.ITEM_ID][rot];
+				for (int gx = -ITEMBLOCKS; gx < GLASS_W; gx++) {
+					int gy = ST.gy;
+					if (checkPieceCollision(&ST.size, ST.rows, P, gx, gy)) {
+						continue;
+					}
+					while (!checkPieceCollision(&ST.size, ST.rows, P, gx, gy + 1)) {
+						gy++;
+					}
+					mu_assert_int_eq(gy, getLandingRow(&ST, P, gx, ST.gy));
+				}
+			}
+			if (ST.GAME_STATE == ITEM_FALLING || ST.GAME_STATE == ITEM_FALLING_FAST) {
+				applyAction(&ST, ACTION_HARD_DROP);
+			}
+			mu_check(ST.GAME_STATE == ITEM_STOPPED && checkItemBottom(&ST));
+			checkRemoveFullLine(&ST);
+			memcpy(heights, ST.heights, sizeof(heights));
+			updateHeights(&ST);
+			mu_check(memcmp(heights, ST.heights, sizeof(heights)) == 0);
+		}
+	}
+}
+
+MU_TEST(test_remove_lines_sizes) {
+	static tAI AI;
+	const int sizes[][2] = {{10, 20}, {14, 28}, {11, 23}, {6, 16}};
+	uint8_t heights[GLASS_MAX_W];
+	// the kernels of the common widths and the one of any width: the bot clears lines, the colors follow the bitboard
+	for (int s = 0; s < 4; s++) {
+		memset(&ST, 0, sizeof(ST));
+		mu_check(setGlassSize(&ST, sizes[s][0], sizes[s][1]));
+		mu_check(initAI(&AI, &ST.size, 1, 1, 10));
+		initRandomizer(&ST, 9, RANDOM_BAG);
+		newGame(&ST);
+		tPlacement pl;
+		int lines = 0;
+		for (int k = 0; k < 150 && spawnItem(&ST, getNextItem(&ST)) && searchPlacement(&AI, &ST, &pl); k++) {
+			ST.gx = pl.gx;
+			ST.gy = pl.gy;
+			ST.ROTATION = pl.rot;
+			copyBlocksToGlass(&ST);
+			lines += checkRemoveFullLine(&ST);
+			memcpy(heights, ST.heights, sizeof(heights));
+			updateHeights(&ST);
+			mu_check(memcmp(heights, ST.heights, sizeof(heights)) == 0);
+			for (int i = 0; i < ST.size.h; i++) {
+				for (int j = 0; j < ST.size.w; j++) {
+					mu_check((GLASS_LINE(&ST, i)[j] != 0) == (ST.rows[i] >> j & 1));
+				}
+			}
+		}
+		mu_check(lines > 0);
+		freeAI(&AI);
+	}
+}
+
+// the same game for the search: bitboard, column heights, item, generator and score
+static bool sameBoard(const tState *A, const tState *B) {
+	return memcmp(A->rows, B->rows, A->size.h * sizeof(A->rows[0])) == 0 &&
+	       memcmp(A->heights, B->heights, sizeof(A->heights)) == 0 && A->GAME_STATE == B->GAME_STATE &&
+	       A->ITEM_ID == B->ITEM_ID && A->ROTATION == B->ROTATION && A->gx == B->gx && A->gy == B->gy &&
+	       A->lines == B->lines && A->items == B->items && A->rng.s == B->rng.s && A->bag_left == B->bag_left &&
+	       memcmp(A->bag, B->bag, sizeof(A->bag)) == 0;
+}
+
+// the same game: the board and the glass colors
+static bool sameGame(const tState *A, const tState *B) {
+	for (int i = 0; i < A->size.h; i++) {
+		if (memcmp(GLASS_LINE(A, i), GLASS_LINE(B, i), A->size.w) != 0) {
+			return false;
+		}
+	}
+	return sameBoard(A, B);
+}
+
+MU_TEST(test_snapshot) {
+	static tState A, B, C, copies[64];
+	static uint64_t buf[SNAPSHOT_MAX_SIZE / 8 + 1], fork[FORK_MAX_SIZE / 8 + 1], empty[FORK_MAX_SIZE / 8 + 1];
+	tUndoStack U;
+	tRng moves;
+	int n = 0;
+	mu_check(initUndo(&U, 1 << 16));
+	memset(&A, 0, sizeof(A));
+	memset(&B, 0, sizeof(B));
+	setGlassSize(&A, GLASS_W, GLASS_H);
+	setGlassSize(&B, GLASS_W, GLASS_H);
+	C = B;
+	initRandomizer(&A, 9, RANDOM_BAG);
+	seedRandom(&moves, 9);
+	newGame(&A);
+	mu_check(getSnapshotSize(&A) == sizeof(tSnapshot) + SNAPSHOT_STRIDE(GLASS_W));
+	mu_check(saveFork(&A, empty) == sizeof(tSnapshot) + SNAPSHOT_STRIDE(GLASS_W));
+	// every item is pushed before it appears, the falling one is saved and restored into another game
+	for (;;) {
+		copies[n] = A;
+		mu_check(pushUndo(&U, &A));
+		if (n == 63 || !spawnItem(&A, getNextItem(&A))) {
+			break;
+		}
+		n++;
+		for (int k = 0; k < 4; k++) {
+			applyAction(&A, policyRandom(&A, &moves));
+		}
+		size_t size = saveSnapshot(&A, buf);
+		mu_check(size == getSnapshotSize(&A) && size <= SNAPSHOT_MAX_SIZE);
+		mu_check(restoreSnapshot(&B, buf) && sameGame(&A, &B));
+		// the fork has the board without the colors
+		size = saveFork(&A, fork);
+		mu_check(size == getForkSize(&A) && size <= FORK_MAX_SIZE && size <= getSnapshotSize(&A));
+		mu_check(restoreFork(&C, fork) && sameBoard(&A, &C));
+		applyAction(&A, ACTION_HARD_DROP);
+		checkRemoveFullLine(&A);
+	}
+	mu_check(n > 10 && U.count == n + 1);
+	// back to the first item, every state as it was
+	for (int k = n; k >= 0; k--) {
+		mu_check(popUndo(&U, &A) && sameGame(&A, &copies[k]));
+	}
+	mu_check(!popUndo(&U, &A) && U.arena.used == 0);
+	// the occupied lines above the forked ones are cleared
+	mu_check(restoreFork(&C, empty) && sameBoard(&A, &C));
+	// a snapshot of another glass size is not restored
+	setGlassSize(&B, 10, 20);
+	mu_check(!restoreSnapshot(&B, buf));
+	// nor a broken one
+	setGlassSize(&B, GLASS_W, GLASS_H);
+	((tSnapshot *)buf)->used = GLASS_H + 1;
+	((tSnapshot *)fork)->used = GLASS_H + 1;
+	mu_check(!restoreSnapshot(&B, buf) && !restoreFork(&C, fork));
+	freeUndo(&U);
+}
+
+MU_TEST(test_auto_shift) {
+	tAutoShift AS;
+	const uint64_t ms = 1000000;
+	initAutoShift(&AS, 170, 50);
+	mu_check(getNextShift(&AS) == UINT64_MAX);
+	pressShift(&AS, ACTION_LEFT, 1000 * ms);
+	// nothing before the delay, then one move per period
+	mu_assert_int_eq(0, takeShiftRepeats(&AS, 1169 * ms, 14));
+	mu_assert_int_eq(1, takeShiftRepeats(&AS, 1170 * ms, 14));
+	mu_assert_int_eq(0, takeShiftRepeats(&AS, 1219 * ms, 14));
+	mu_assert_int_eq(3, takeShiftRepeats(&AS, 1320 * ms, 14));
+	mu_check(getNextShift(&AS) == 1370 * ms);
+	mu_assert_int_eq(14, takeShiftRepeats(&AS, 9000 * ms, 14));
+	// the last pressed key repeats, the released one gives way to the held one
+	pressShift(&AS, ACTION_RIGHT, 9100 * ms);
+	mu_check(AS.held == ACTION_RIGHT);
+	releaseShift(&AS, ACTION_RIGHT, 9200 * ms);
+	mu_check(AS.held == ACTION_LEFT && getNextShift(&AS) == 9370 * ms);
+	releaseShift(&AS, ACTION_LEFT, 9300 * ms);
+	mu_assert_int_eq(0, takeShiftRepeats(&AS, 9400 * ms, 14));
+	mu_check(getNextShift(&AS) == UINT64_MAX);
+	// ARR 0: the item slides to the wall
+	initAutoShift(&AS, 100, 0);
+	pressShift(&AS, ACTION_RIGHT, 0);
+	mu_assert_int_eq(0, takeShiftRepeats(&AS, 99 * ms, 10));
+	mu_assert_int_eq(10, takeShiftRepeats(&AS, 100 * ms, 10));
+	mu_assert_int_eq(10, takeShiftRepeats(&AS, 101 * ms, 10));
+}
+
+MU_TEST(test_prof_percentile) {
+	static tProfiler P;
+	initProfiler(&P);
+	mu_check(getPercentile(&P.hist[PHASE_FRAME], 0.5) == 0);
+	// 0.2..19.8 ms frames and one 100 ms frame beyond the buckets
+	for (int i = 1; i < 100; i++) {
+		addSample(&P, PHASE_FRAME, (uint64_t)i * 200000);
+	}
+	addSample(&P, PHASE_FRAME, 100000000);
+	const tHist *H = &P.hist[PHASE_FRAME];
+	mu_check(H->n == 100 && H->max == 100000000);
+	mu_check(getPercentile(H, 0.0) == 200000 + PROF_BUCKET_NS);
+	mu_check(getPercentile(H, 0.5) == 10000000 + PROF_BUCKET_NS);
+	mu_check(getPercentile(H, 0.99) == 19800000 + PROF_BUCKET_NS);
+	mu_check(getPercentile(H, 1.0) == 100000000);
+}
+
 MU_TEST_SUITE(test_suite_tetris) {
 	// min4()
 	MU_RUN_TEST(test_min4_01);
@@ -38,6 +624,37 @@ MU_TEST_SUITE(test_suite_tetris) {
 	MU_RUN_TEST(test_max4_02);
 	MU_RUN_TEST(test_max4_03);
 	MU_RUN_TEST(test_max4_04);
+	// item collisions
+	MU_SUITE_CONFIGURE(&setup_item_O, NULL);
+	MU_RUN_TEST(test_collision_walls);
+	MU_RUN_TEST(test_collision_blocks);
+	MU_RUN_TEST(test_copy_blocks);
+	MU_RUN_TEST(test_placements_tuck);
+	// item rotations
+	MU_SUITE_CONFIGURE(&setup_item_I, NULL);
+	MU_RUN_TEST(test_pieces_table);
+	MU_RUN_TEST(test_rotate_item);
+	MU_RUN_TEST(test_remove_full_lines);
+	// item generator
+	MU_RUN_TEST(test_random_seed);
+	MU_RUN_TEST(test_random_bag);
+	// placements
+	MU_RUN_TEST(test_placements_empty);
+	// board evaluation
+	MU_RUN_TEST(test_eval_board);
+	MU_RUN_TEST(test_eval_random);
+	// bot
+	MU_RUN_TEST(test_remove_full_rows);
+	MU_RUN_TEST(test_ai_play);
+	MU_RUN_TEST(test_glass_size);
+	// replays
+	MU_RUN_TEST(test_replay);
+	MU_RUN_TEST(test_landing_row);
+	MU_RUN_TEST(test_remove_lines_sizes);
+	MU_RUN_TEST(test_snapshot);
+	MU_RUN_TEST(test_auto_shift);
+	// profiler
+	MU_RUN_TEST(test_prof_percentile);
 }
 
 int main(int argc, char *argv[]) {
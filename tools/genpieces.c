@@ -0,0 +1,204 @@
+/**
+ * @brief Generator of the rotation table of the items (src/pieces.c)
+ *
+ * Usage: genpieces > src/pieces.c
+ *
+ * All 4 rotations of every item are produced by the same left rotation of
+ * the 4x4 block matrix that the game used at run time, together with the
+ * margins, line bitmasks and bounding boxes the collision checks rely on.
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define MAXITEMS 7
+#define ITEMBLOCKS 4
+#define ROTATIONS 4
+
+static const char *names[MAXITEMS] = {"I", "O", "L", "J", "S", "Z", "T"};
+
+static const int8_t items[MAXITEMS][ITEMBLOCKS * ITEMBLOCKS] = {{0, 1, 0, 0,  //
+                                                                 0, 1, 0, 0,  //
+                                                                 0, 1, 0, 0,  //
+                                                                 0, 1, 0, 0}, // I
+                                                                {0, 0, 0, 0,  //
+                                                                 0, 2, 2, 0,  //
+                                                                 0, 2, 2, 0,  //
+                                                                 0, 0, 0, 0}, // O
+                                                                {0, 0, 0, 0,  //
+                                                                 0, 3, 0, 0,  //
+                                                                 0, 3, 0, 0,  //
+                                                                 0, 3, 3, 0}, // L
+                                                                {0, 0, 0, 0,  //
+                                                                 0, 0, 3, 0,  //
+                                                                 0, 0, 3, 0,  //
+                                                                 0, 3, 3, 0}, // J
+                                                                {0, 0, 0, 0,  //
+                                                                 0, 4, 0, 0,  //
+                                                                 0, 4, 4, 0,  //
+                                                                 0, 0, 4, 0}, // S
+                                                                {0, 0, 0, 0,  //
+                                                                 0, 0, 4, 0,  //
+                                                                 0, 4, 4, 0,  //
+                                                                 0, 4, 0, 0}, // Z
+                                                                {0, 0, 0, 0,  //
+                                                                 0, 5, 0, 0,  //
+                                                                 5, 5, 5, 0,  //
+                                                                 0, 0, 0, 0}}; // T
+
+static void rotateMatrix(int8_t *mat)
+{
+    for (int i = 0; i < ITEMBLOCKS / 2; i++)
+    {
+        for (int j = i; j < ITEMBLOCKS - i - 1; j++)
+        {
+            int index1 = i * ITEMBLOCKS + j;
+            int index2 = j * ITEMBLOCKS + (ITEMBLOCKS - 1 - i);
+            int index3 = (ITEMBLOCKS - 1 - i) * ITEMBLOCKS + (ITEMBLOCKS - 1 - j);
+            int index4 = (ITEMBLOCKS - 1 - j) * ITEMBLOCKS + i;
+            int8_t temp = mat[index1];
+            mat[index1] = mat[index2];
+            mat[index2] = mat[index3];
+            mat[index3] = mat[index4];
+            mat[index4] = temp;
+        }
+    }
+}
+
+static void printArray(const char *name, const int8_t *a, int n)
+{
+    printf(".%s = {", name);
+    for (int i = 0; i < n; i++)
+    {
+        printf(i ? ", %d" : "%d", a[i]);
+    }
+    printf("}");
+}
+
+static void getRows(const int8_t *mat, int8_t *rows, int8_t *top)
+{
+    int8_t left = ITEMBLOCKS;
+    *top = ITEMBLOCKS;
+    for (int i = 0; i < ITEMBLOCKS; i++)
+    {
+        for (int j = 0; j < ITEMBLOCKS; j++)
+        {
+            if (mat[i * ITEMBLOCKS + j] > 0)
+            {
+                if (j < left)
+                    left = (int8_t)j;
+                if (i < *top)
+                    *top = (int8_t)i;
+            }
+        }
+    }
+    for (int i = 0; i < ITEMBLOCKS; i++)
+    {
+        rows[i] = 0;
+        for (int j = 0; j < ITEMBLOCKS; j++)
+        {
+            if (mat[i * ITEMBLOCKS + j] > 0)
+            {
+                rows[i] |= (int8_t)(1 << (j - left));
+            }
+        }
+    }
+}
+
+// first rotation with the same blocks (up to a shift) as rotation r
+static int getShape(const int8_t (*rotations)[ITEMBLOCKS * ITEMBLOCKS], int r)
+{
+    int8_t rows[ITEMBLOCKS], top;
+    getRows(rotations[r], rows, &top);
+    for (int k = 0; k < r; k++)
+    {
+        int8_t other[ITEMBLOCKS], other_top;
+        getRows(rotations[k], other, &other_top);
+        bool same = true;
+        for (int i = 0; i < ITEMBLOCKS; i++)
+        {
+            int8_t a = top + i < ITEMBLOCKS ? rows[top + i] : 0;
+            int8_t b = other_top + i < ITEMBLOCKS ? other[other_top + i] : 0;
+            same = same && a == b;
+        }
+        if (same)
+        {
+            return k;
+        }
+    }
+    return r;
+}
+
+static void printPiece(const int8_t *mat, int shape)
+{
+    int8_t left[ITEMBLOCKS], right[ITEMBLOCKS], bottom[ITEMBLOCKS], rows[ITEMBLOCKS];
+    int8_t bl = ITEMBLOCKS, br = -1, bt = ITEMBLOCKS, bb = -1;
+
+    for (int i = 0; i < ITEMBLOCKS; i++)
+    {
+        for (left[i] = 0; left[i] < ITEMBLOCKS && mat[i * ITEMBLOCKS + left[i]] == 0; left[i]++)
+            ;
+        for (right[i] = ITEMBLOCKS - 1; right[i] >= 0 && mat[i * ITEMBLOCKS + right[i]] == 0; right[i]--)
+            ;
+        for (bottom[i] = ITEMBLOCKS - 1; bottom[i] >= 0 && mat[bottom[i] * ITEMBLOCKS + i] == 0; bottom[i]--)
+            ;
+        if (left[i] < bl)
+            bl = left[i];
+        if (right[i] > br)
+            br = right[i];
+        if (bottom[i] > bb)
+            bb = bottom[i];
+        if (right[i] >= 0 && i < bt)
+            bt = (int8_t)i;
+    }
+    for (int i = 0; i < ITEMBLOCKS; i++)
+    {
+        rows[i] = 0;
+        for (int j = 0; j < ITEMBLOCKS; j++)
+        {
+            if (mat[i * ITEMBLOCKS + j] > 0)
+            {
+                rows[i] |= (int8_t)(1 << (j - bl));
+            }
+        }
+    }
+
+    printf("        {");
+    printArray("blocks", mat, ITEMBLOCKS * ITEMBLOCKS);
+    printf(",\n         ");
+    printArray("marg_left", left, ITEMBLOCKS);
+    printf(",\n         ");
+    printArray("marg_right", right, ITEMBLOCKS);
+    printf(",\n         ");
+    printArray("marg_bottom", bottom, ITEMBLOCKS);
+    printf(",\n         ");
+    printArray("rows", rows, ITEMBLOCKS);
+    printf(",\n         .left = %d, .right = %d, .top = %d, .bottom = %d, .shape = %d}", bl, br, bt, bb, shape);
+}
+
+int main(void)
+{
+    printf("// Generated by tools/genpieces.c, do not edit\n");
+    printf("#include \"tetris_core.h\"\n\n");
+    printf("const tPiece PIECES[MAXITEMS][ROTATIONS] = {\n");
+    for (int id = 0; id < MAXITEMS; id++)
+    {
+        int8_t rotations[ROTATIONS][ITEMBLOCKS * ITEMBLOCKS];
+        memcpy(rotations[0], items[id], sizeof(rotations[0]));
+        for (int r = 1; r < ROTATIONS; r++)
+        {
+            memcpy(rotations[r], rotations[r - 1], sizeof(rotations[r]));
+            rotateMatrix(rotations[r]);
+        }
+        printf("    // %s\n    {\n", names[id]);
+        for (int r = 0; r < ROTATIONS; r++)
+        {
+            printPiece(rotations[r], getShape(rotations, r));
+            printf(r < ROTATIONS - 1 ? ",\n" : "\n");
+        }
+        printf(id < MAXITEMS - 1 ? "    },\n" : "    }\n");
+    }
+    printf("};\n");
+    return 0;
+}